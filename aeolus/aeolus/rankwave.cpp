@@ -23,21 +23,14 @@
 extern float exp2ap (float);
 
 
-Rngen   Pipewave::_rgen;
-float  *Pipewave::_arg = 0;
-float  *Pipewave::_att = 0;
+// Wave files are a 96 byte header followed by the pipes. Bump
+// the version when the generated data or the layout changes.
 
+#define WAVE_VERSION 2
+#define WAVE_HEADER  96
 
-void Pipewave::initstatic (float fsamp)
-{
-    int k;
 
-    if (_arg) return;
-    k = (int)(fsamp);
-    _arg = new float [k];
-    k = (int)(0.5f * fsamp);
-    _att = new float [k];
-}
+Rngen   Pipewave::_rgen;
 
 
 void Pipewave::play (void)
@@ -180,7 +173,7 @@ void Pipewave::play (void)
 }
 
 
-void Pipewave::genwave (Addsynth *D, int n, float fsamp, float fpipe)
+void Pipewave::genwave (Addsynth *D, int n, float fsamp, float fpipe, float *arg, float *att, Rngen *rgen)
 {
     int    h, i, k, nc;
     float  f0, f1, f, m, t, v, v0;
@@ -194,7 +187,7 @@ void Pipewave::genwave (Addsynth *D, int n, float fsamp, float fpipe)
     _l0 = (int)(fsamp * m + 0.5);
     _l0 = (_l0 + PERIOD - 1) & ~(PERIOD - 1);
 
-    f1 = (fpipe + D->_n_off.vi (n) + D->_n_ran.vi (n) * (2 * _rgen.urand () - 1)) / fsamp;
+    f1 = (fpipe + D->_n_off.vi (n) + D->_n_ran.vi (n) * (2 * rgen->urand () - 1)) / fsamp;
     f0 = f1 * exp2ap (D->_n_atd.vi (n) / 1200.0f);
 
     for (h = N_HARM - 1; h >= 0; h--)
@@ -216,7 +209,8 @@ void Pipewave::genwave (Addsynth *D, int n, float fsamp, float fpipe)
 
     k = _l0 + _l1 + _k_s * (PERIOD + 4);
 
-    delete[] _p0;
+    if (! _mapped) delete[] _p0;
+    _mapped = false;
     _p0 = new float [k];
     _p1 = _p0 + _l0;
     _p2 = _p1 + _l1;
@@ -231,14 +225,14 @@ void Pipewave::genwave (Addsynth *D, int n, float fsamp, float fpipe)
     k = (int)(fsamp * D->_n_att.vi (n) + 0.5);
     for (i = 0; i <= _l0; i++)
     {
-        _arg [i] = t - floorf (t + 0.5);
+        arg [i] = t - floorf (t + 0.5);
 	t += (i < k) ? (((k - i) * f0 + i * f1) / k) : f1;
     }
 
     for (i = 1; i < _l1; i++)
     {
-	t = _arg [_l0]+ (float) i * nc / _l1;
-        _arg [i + _l0] = t - floorf (t + 0.5);
+	t = arg [_l0]+ (float) i * nc / _l1;
+        arg [i + _l0] = t - floorf (t + 0.5);
     }
 
     v0 = exp2ap (0.1661 * D->_n_vol.vi (n));
@@ -248,16 +242,16 @@ void Pipewave::genwave (Addsynth *D, int n, float fsamp, float fpipe)
         v = D->_h_lev.vi (h, n);
         if (v < -80.0) continue;
 
-        v = v0 * exp2ap (0.1661 * (v + D->_h_ran.vi (h, n) * (2 * _rgen.urand () - 1)));
+        v = v0 * exp2ap (0.1661 * (v + D->_h_ran.vi (h, n) * (2 * rgen->urand () - 1)));
         k = (int)(fsamp * D->_h_att.vi (h, n) + 0.5);
-        attgain (k, D->_h_atp.vi (h, n));
+        attgain (k, D->_h_atp.vi (h, n), att);
 
         for (i = 0; i < _l0 + _l1; i++)
         {
-	    t = _arg [i] * (h + 1);
+	    t = arg [i] * (h + 1);
             t -= floorf (t);
             m = v * sinf (2 * M_PI * t);
-            if (i < k) m *= _att [i];
+            if (i < k) m *= att [i];
             _p0 [i] += m;
         }
     }
@@ -308,7 +302,7 @@ void Pipewave::looplen (float f, float fsamp, int lmax, int *aa, int *bb)
 }
 
 
-void Pipewave::attgain (int n, float p)
+void Pipewave::attgain (int n, float p, float *att)
 {
     int    i, j, k;
     float  d, m, w, x, y, z;
@@ -328,14 +322,14 @@ void Pipewave::attgain (int n, float p)
         while (j < k)
 	{
             m = (double) j / n;
-            _att [j++] = (1.0 - m) * z + m;
+            att [j++] = (1.0 - m) * z + m;
             z += d;
 	}
     }
 }
 
 
-void Pipewave::save (FILE *F)
+void Pipewave::save (QFile *F)
 {
     int  k;
     union
@@ -350,17 +344,20 @@ void Pipewave::save (FILE *F)
     d.i16 [4] = _k_s;
     d.i16 [5] = _k_r;
     d.flt [3] = _m_r;
-    d.i32 [4] = 0;
-    d.i32 [5] = 0;
+    d.flt [4] = _d_r;
+    d.flt [5] = _d_p;
     d.i32 [6] = 0;
     d.i32 [7] = 0;
-    fwrite (&d, 1, 32, F);
+    F->write ((const char *) &d, 32);
     k = _l0 +_l1 + _k_s * (PERIOD + 4);
-    fwrite (_p0, k, sizeof (float), F);
+    F->write ((const char *) _p0, k * sizeof (float));
 }
 
 
-void Pipewave::load (FILE *F)
+// Point the pipe at its wave in a mapped file, return the
+// start of the next pipe or 0 if the data is truncated.
+
+const char *Pipewave::map (const char *p, const char *e)
 {
     int  k;
     union
@@ -370,24 +367,29 @@ void Pipewave::load (FILE *F)
 	float   flt [8];
     } d;
 
-    fread (&d, 1, 32, F);
+    if (e - p < 32) return 0;
+    memcpy (&d, p, 32);
+    k = d.i32 [0] + d.i32 [1] + d.i16 [4] * (PERIOD + 4);
+    if ((d.i32 [0] < 0) || (d.i32 [1] <= 0) || (k <= 0) || ((e - p - 32) / (int) sizeof (float) < k)) return 0;
+    if (! _mapped) delete[] _p0;
+    _mapped = true;
     _l0  = d.i32 [0];
     _l1  = d.i32 [1];
     _k_s = d.i16 [4];
     _k_r = d.i16 [5];
     _m_r = d.flt [3];
-    k = _l0 +_l1 + _k_s * (PERIOD + 4);
-    delete[] _p0;
-    _p0 = new float [k];
+    _d_r = d.flt [4];
+    _d_p = d.flt [5];
+    _p0 = (float *)(p + 32);
     _p1 = _p0 + _l0;
     _p2 = _p1 + _l1;
-    fread (_p0, k, sizeof (float), F);
+    return p + 32 + k * sizeof (float);
 }
 
 
 
 
-Rankwave::Rankwave (int n0, int n1) : _n0 (n0), _n1 (n1), _list (0), _modif (false)
+Rankwave::Rankwave (int n0, int n1) : _n0 (n0), _n1 (n1), _list (0), _modif (false), _file (0)
 {
     _pipes = new Pipewave [n1 - n0 + 1];
 }
@@ -396,18 +398,54 @@ Rankwave::Rankwave (int n0, int n1) : _n0 (n0), _n1 (n1), _list (0), _modif (fal
 Rankwave::~Rankwave (void)
 {
     delete[] _pipes;
+    delete _file;
+}
+
+
+struct Rankwave::Pipejob
+{
+    Pipewave  *P;
+    Addsynth  *D;
+    int        n;
+    float      fsamp;
+    float      fpipe;
+    uint32_t   seed;
+};
+
+
+void Rankwave::genpipe (Pipejob &J)
+{
+    QVector<float> arg ((int)(J.fsamp) + 1);
+    QVector<float> att ((int)(0.5f * J.fsamp) + 1);
+    Rngen          rgen;
+
+    rgen.init (J.seed);
+    J.P->genwave (J.D, J.n, J.fsamp, J.fpipe, arg.data (), att.data (), &rgen);
 }
 
 
 void Rankwave::gen_waves (Addsynth *D, float fsamp, float fbase, float *scale)
 {
-    Pipewave::initstatic (fsamp);
+    QVector<Pipejob> jobs;
+    uint32_t         seed;
 
+    // Pipes are generated concurrently, each with its own random
+    // generator seeded from the stop and note, so the result does
+    // not depend on the order in which they are computed.
+    seed = qHash (QByteArray (D->_filename));
     fbase *=  D->_fn / (D->_fd * scale [9]);
     for (int i = _n0; i <= _n1; i++)
     {
-	_pipes [i - _n0].genwave (D, i - _n0, fsamp, ldexpf (fbase * scale [i % 12], i / 12 - 5));
+        Pipejob J;
+        J.P = _pipes + (i - _n0);
+        J.D = D;
+        J.n = i - _n0;
+        J.fsamp = fsamp;
+        J.fpipe = ldexpf (fbase * scale [i % 12], i / 12 - 5);
+        J.seed = (seed * 131 + i) | 1;
+        jobs.append (J);
     }
+    QtConcurrent::blockingMap (jobs, genpipe);
     _modif = true;
 }
 
@@ -447,143 +485,132 @@ void Rankwave::play (int shift)
 }
 
 
-int Rankwave::save (const char *path, Addsynth *D, float fsamp, float fbase, float *scale)
+QString Rankwave::filename (const char *path, Addsynth *D)
 {
-    FILE      *F;
-    Pipewave  *P;
-    int        i;
-    char       name [1024];
-    char       data [64];
-    char      *p;
+    QString name = QString ("%1/%2").arg (path).arg (D->_filename);
+    int     i = name.lastIndexOf ('.');
 
-    sprintf (name, "%s/%s", path, D->_filename);
-    if ((p = strrchr (name, '.'))) strcpy (p, ".ae1");
-    else strcat (name, ".ae1");
+    if (i > name.lastIndexOf ('/')) name.truncate (i);
+    return name + ".ae2";
+}
 
-    F = fopen (name, "wb");
-    if (F == NULL)
-    {
-	fprintf (stderr, "Can't open waveform file '%s' for writing\n", name);
-        return 1;
-    }
 
-    memset (data, 0, 16);
-    strcpy (data, "ae1");
-    data [4] = 1;
-    fwrite (data, 1, 16, F);
-
-    memset (data, 0, 64);
-    data [0] = 0;
-    data [1] = 0;
-    data [2] = 0;
-    data [3] = 0;
-    data [4] = _n0;
-    data [5] = _n1;
-    data [6] = 0;
-    data [7] = 0;
-    *((float *)(data +  8)) = fsamp;
-    *((float *)(data + 12)) = fbase;
-    memcpy (data + 16, scale, 12 * sizeof (float));
-    fwrite (data, 1, 64, F);
-
-    for (i = _n0, P = _pipes; i <= _n1; i++, P++) P->save (F);
-
-    fclose (F);
+// The cache key: everything the generated waves depend on.
 
-    _modif = false;
-    return 0;
+QByteArray Rankwave::key (Addsynth *D, float fsamp, float fbase, float *scale)
+{
+    QCryptographicHash h (QCryptographicHash::Md5);
+
+    h.addData ((const char *) &D->_n0, (const char *) &D->_pan - (const char *) &D->_n0);
+    h.addData ((const char *) &fsamp, sizeof (float));
+    h.addData ((const char *) &fbase, sizeof (float));
+    h.addData ((const char *) scale, 12 * sizeof (float));
+    return h.result ();
 }
 
 
-int Rankwave::load (const char *path, Addsynth *D, float fsamp, float fbase, float *scale)
+int Rankwave::save (const char *path, Addsynth *D, float fsamp, float fbase, float *scale)
 {
-    FILE      *F;
     Pipewave  *P;
     int        i;
-    char       name [1024];
-    char       data [64];
-    char      *p;
-    float      f;
-
-    sprintf (name, "%s/%s", path, D->_filename);
-    if ((p = strrchr (name, '.'))) strcpy (p, ".ae1");
-    else strcat (name, ".ae1");
+    char       data [WAVE_HEADER];
+    QString    name = filename (path, D);
 
-    F = fopen (name, "rb");
-    if (F == NULL)
+    // Write to a temporary file first: other processes or
+    // synthesizers may be mapping the current one.
+    QTemporaryFile F (name + ".XXXXXX");
+    if (! F.open ())
     {
-#ifdef DEBUG
-	fprintf (stderr, "Can't open waveform file '%s' for reading\n", name);
-#endif
+	fprintf (stderr, "Can't open waveform file '%s' for writing\n", qPrintable (name));
         return 1;
     }
 
-    fread (data, 1, 16, F);
-    if (strcmp (data, "ae1"))
-    {
-#ifdef DEBUG
-	fprintf (stderr, "File '%s' is not an Aeolus waveform file\n", name);
-#endif
-        fclose (F);
-        return 1;
-    }
+    memset (data, 0, WAVE_HEADER);
+    strcpy (data, "ae2");
+    *((int32_t *)(data +  4)) = WAVE_VERSION;
+    *((int32_t *)(data +  8)) = _n0;
+    *((int32_t *)(data + 12)) = _n1;
+    *((float *)(data + 16)) = fsamp;
+    *((float *)(data + 20)) = fbase;
+    memcpy (data + 24, scale, 12 * sizeof (float));
+    memcpy (data + 72, key (D, fsamp, fbase, scale).constData (), 16);
+    F.write (data, WAVE_HEADER);
+
+    for (i = _n0, P = _pipes; i <= _n1; i++, P++) P->save (&F);
 
-    if (data [4] != 1)
+    if (F.error () != QFile::NoError)
     {
-#ifdef DEBUG
-	fprintf (stderr, "File '%s' has an incompatible version tag (%d)\n", name, data [4]);
-#endif
-        fclose (F);
+	fprintf (stderr, "Can't write waveform file '%s'\n", qPrintable (name));
         return 1;
     }
+    F.close ();
+    QFile::remove (name);
+    if (QFile::rename (F.fileName (), name)) F.setAutoRemove (false);
+
+    _modif = false;
+    return 0;
+}
+
+
+// Map the wave file instead of reading it; the pipes play
+// directly from the mapping.
 
-    fread (data, 1, 64, F);
-    if (_n0 != data [4] || _n1 != data [5])
+int Rankwave::load (const char *path, Addsynth *D, float fsamp, float fbase, float *scale)
+{
+    Pipewave    *P;
+    int          i;
+    const char  *p, *e;
+    QString      name = filename (path, D);
+    QFile       *F = new QFile (name);
+
+    if (! F->open (QIODevice::ReadOnly) || F->size () < WAVE_HEADER
+        || ! (p = (const char *) F->map (0, F->size ())))
     {
 #ifdef DEBUG
-	fprintf (stderr, "File '%s' has an incompatible note range (%d %d), (%d %d)\n", name, _n0, _n1, data [4], data [5]);
+	fprintf (stderr, "Can't map waveform file '%s'\n", qPrintable (name));
 #endif
-        fclose (F);
+        delete F;
         return 1;
     }
+    e = p + F->size ();
 
-    f = *((float *)(data + 8));
-    if (fabsf (f - fsamp) > 0.1f)
+    if (strcmp (p, "ae2") || *((int32_t *)(p + 4)) != WAVE_VERSION)
     {
 #ifdef DEBUG
-	fprintf (stderr, "File '%s' has a different sample frequency (%3.1lf)\n", name, f);
+	fprintf (stderr, "File '%s' is not an Aeolus waveform file of version %d\n", qPrintable (name), WAVE_VERSION);
 #endif
-        fclose (F);
+        delete F;
         return 1;
     }
 
-    f = *((float *)(data + 12));
-    if (fabsf (f - fbase) > 0.1f)
+    if (*((int32_t *)(p + 8)) != _n0 || *((int32_t *)(p + 12)) != _n1
+        || memcmp (p + 72, key (D, fsamp, fbase, scale).constData (), 16))
     {
 #ifdef DEBUG
-	fprintf (stderr, "File '%s' has a different tuning (%3.1lf)\n", name, f);
+	fprintf (stderr, "File '%s' is out of date\n", qPrintable (name));
 #endif
-        fclose (F);
+        delete F;
         return 1;
     }
 
-    for (i = 0; i < 12; i++)
+    // Check the whole file before any pipe refers to it.
+    Pipewave Q;
+    const char *q = p + WAVE_HEADER;
+    for (i = _n0; q && i <= _n1; i++) q = Q.map (q, e);
+    if (! q)
     {
-        f = *((float *)(data + 16 + 4 * i));
-        if (fabsf (f /  scale [i] - 1.0f) > 6e-5f)
-        {
 #ifdef DEBUG
-	    fprintf (stderr, "File '%s' has a different temperament\n", name);
+	fprintf (stderr, "File '%s' is truncated\n", qPrintable (name));
 #endif
-            fclose (F);
-            return 1;
-        }
+        delete F;
+        return 1;
     }
 
-    for (i = _n0, P = _pipes; i <= _n1; i++, P++) P->load (F);
-
-    fclose (F);
+    p += WAVE_HEADER;
+    for (i = _n0, P = _pipes; i <= _n1; i++, P++) p = P->map (p, e);
 
+    delete _file;
+    _file = F;
     _modif = false;
     return 0;
 }
@@ -56,7 +56,7 @@ void Channel::init()
       {
       sfontnum      = 0;
       setPreset(synth->find_preset(banknum, prognum));
-      interp_method = FLUID_INTERP_DEFAULT;
+      interp_method = synth->interpMethod();
       nrpn_select   = 0;
       }
 
@@ -221,7 +221,7 @@ void Channel::setPreset(Preset* p)
       {
       if (_preset != p) {
             if (p)
-                  p->loadSamples();
+                  synth->loadSamples(p);
             _preset = p;
             }
       }
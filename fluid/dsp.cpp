@@ -21,6 +21,7 @@
 #include "fluid.h"
 #include "voice.h"
 #include "sfont.h"
+#include "mix.h"
 
 namespace FluidS {
 
@@ -38,8 +39,9 @@ namespace FluidS {
  *              part and a fractional part.
  *              If a sample is played at root pitch (no pitch change),
  *              dsp_phase_incr is integer=1 and fractional=0.
- * - dsp_amp: The current amplitude envelope value.
- * - dsp_amp_incr: The changing rate of the amplitude envelope.
+ *
+ * The amplitude envelope (voice->amp, changing by voice->amp_incr per
+ * sample) is applied to the whole buffer afterwards by Mix::ramp().
  *
  * A couple of variables are used internally, their results are discarded:
  * - dsp_i: Index through the output buffer
@@ -122,8 +124,6 @@ int Voice::dsp_float_interpolate_none(unsigned n)
       Phase dsp_phase_incr; //  end_phase;
       short int *dsp_data = voice->sample->data;
       float *dsp_buf = voice->dsp_buf;
-      float dsp_amp = voice->amp;
-      float dsp_amp_incr = voice->amp_incr;
       unsigned int dsp_i = 0;
       unsigned int dsp_phase_index;
       unsigned int end_index;
@@ -144,12 +144,11 @@ int Voice::dsp_float_interpolate_none(unsigned n)
 
             /* interpolate sequence of sample points */
             for ( ; dsp_i < n && dsp_phase_index <= end_index; dsp_i++) {
-                  dsp_buf[dsp_i] = dsp_amp * dsp_data[dsp_phase_index];
+                  dsp_buf[dsp_i] = dsp_data[dsp_phase_index];
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index_round();	/* round to nearest point */
-                  dsp_amp += dsp_amp_incr;
                   }
 
             /* break out if not looping (buffer may not be full) */
@@ -168,7 +167,7 @@ int Voice::dsp_float_interpolate_none(unsigned n)
             }
 
       voice->phase = dsp_phase;
-      voice->amp = dsp_amp;
+      voice->amp   = Mix::ramp(dsp_buf, voice->amp, voice->amp_incr, dsp_i);
       return dsp_i;
       }
 
@@ -186,8 +185,6 @@ int Voice::dsp_float_interpolate_linear(unsigned n)
       Phase dsp_phase_incr; // end_phase;
       short int *dsp_data = voice->sample->data;
       float *dsp_buf = voice->dsp_buf;
-      float dsp_amp = voice->amp;
-      float dsp_amp_incr = voice->amp_incr;
       unsigned int dsp_i = 0;
       unsigned int dsp_phase_index;
       unsigned int end_index;
@@ -218,13 +215,12 @@ int Voice::dsp_float_interpolate_linear(unsigned n)
             /* interpolate the sequence of sample points */
             for ( ; dsp_i < n && dsp_phase_index <= end_index; dsp_i++) {
                   coeffs = interp_coeff_linear[fluid_phase_fract_to_tablerow (dsp_phase)];
-                  dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * dsp_data[dsp_phase_index]
+                  dsp_buf[dsp_i] = (coeffs[0] * dsp_data[dsp_phase_index]
 				  + coeffs[1] * dsp_data[dsp_phase_index+1]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index();
-                  dsp_amp += dsp_amp_incr;
                   }
 
             /* break out if buffer filled */
@@ -236,13 +232,12 @@ int Voice::dsp_float_interpolate_linear(unsigned n)
             /* interpolate within last point */
             for (; dsp_phase_index <= end_index && dsp_i < n; dsp_i++) {
                   coeffs = interp_coeff_linear[fluid_phase_fract_to_tablerow (dsp_phase)];
-                  dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * dsp_data[dsp_phase_index]
+                  dsp_buf[dsp_i] = (coeffs[0] * dsp_data[dsp_phase_index]
                      + coeffs[1] * point);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index();
-                  dsp_amp += dsp_amp_incr;	/* increment amplitude */
                   }
 
             if (!looping)
@@ -261,7 +256,7 @@ int Voice::dsp_float_interpolate_linear(unsigned n)
             }
 
       voice->phase = dsp_phase;
-      voice->amp = dsp_amp;
+      voice->amp   = Mix::ramp(dsp_buf, voice->amp, voice->amp_incr, dsp_i);
       return dsp_i;
       }
 
@@ -276,7 +271,6 @@ int Voice::dsp_float_interpolate_4th_order(unsigned n)
       {
       Phase dsp_phase_incr; // end_phase;
       short int* dsp_data = sample->data;
-      float dsp_amp_incr  = amp_incr;
       unsigned int dsp_i  = 0;
       unsigned int dsp_phase_index;
       unsigned int start_index;
@@ -319,29 +313,27 @@ int Voice::dsp_float_interpolate_4th_order(unsigned n)
             /* interpolate first sample point (start or loop start) if needed */
             for ( ; dsp_phase_index == start_index && dsp_i < n; dsp_i++) {
                   coeffs = interp_coeff[fluid_phase_fract_to_tablerow (phase)];
-                  dsp_buf[dsp_i] = amp * (coeffs[0] * start_point
+                  dsp_buf[dsp_i] = (coeffs[0] * start_point
 				  + coeffs[1] * dsp_data[dsp_phase_index]
 				  + coeffs[2] * dsp_data[dsp_phase_index+1]
 				  + coeffs[3] * dsp_data[dsp_phase_index+2]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   phase += dsp_phase_incr;
                   dsp_phase_index = phase.index();
-                  amp += dsp_amp_incr;
                   }
 
             /* interpolate the sequence of sample points */
             for ( ; dsp_i < n && dsp_phase_index <= end_index; dsp_i++) {
                   coeffs = interp_coeff[fluid_phase_fract_to_tablerow (phase)];
-                  dsp_buf[dsp_i] = amp * (coeffs[0] * dsp_data[dsp_phase_index-1]
+                  dsp_buf[dsp_i] = (coeffs[0] * dsp_data[dsp_phase_index-1]
 				  + coeffs[1] * dsp_data[dsp_phase_index]
 				  + coeffs[2] * dsp_data[dsp_phase_index+1]
 				  + coeffs[3] * dsp_data[dsp_phase_index+2]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   phase += dsp_phase_incr;
                   dsp_phase_index = phase.index();
-                  amp += dsp_amp_incr;
                   }
 
             /* break out if buffer filled */
@@ -353,15 +345,14 @@ int Voice::dsp_float_interpolate_4th_order(unsigned n)
             /* interpolate within 2nd to last point */
             for (; dsp_phase_index <= end_index && dsp_i < n; dsp_i++) {
                   coeffs = interp_coeff[fluid_phase_fract_to_tablerow (phase)];
-                  dsp_buf[dsp_i] = amp * (coeffs[0] * dsp_data[dsp_phase_index-1]
+                  dsp_buf[dsp_i] = (coeffs[0] * dsp_data[dsp_phase_index-1]
 				  + coeffs[1] * dsp_data[dsp_phase_index]
 				  + coeffs[2] * dsp_data[dsp_phase_index+1]
 				  + coeffs[3] * end_point1);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   phase += dsp_phase_incr;
                   dsp_phase_index = phase.index();
-                  amp += dsp_amp_incr;
                   }
 
             end_index++;	/* we're now interpolating the last point */
@@ -369,15 +360,14 @@ int Voice::dsp_float_interpolate_4th_order(unsigned n)
             /* interpolate within the last point */
             for (; dsp_phase_index <= end_index && dsp_i < n; dsp_i++) {
                   coeffs = interp_coeff[fluid_phase_fract_to_tablerow (phase)];
-                  dsp_buf[dsp_i] = amp * (coeffs[0] * dsp_data[dsp_phase_index-1]
+                  dsp_buf[dsp_i] = (coeffs[0] * dsp_data[dsp_phase_index-1]
 				  + coeffs[1] * dsp_data[dsp_phase_index]
 				  + coeffs[2] * end_point1
 				  + coeffs[3] * end_point2);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   phase += dsp_phase_incr;
                   dsp_phase_index = phase.index();
-                  amp += dsp_amp_incr;
                   }
 
             if (!looping)
@@ -397,6 +387,7 @@ int Voice::dsp_float_interpolate_4th_order(unsigned n)
                   break;
             end_index -= 2;	/* set end back to third to last sample point */
             }
+      amp = Mix::ramp(dsp_buf, amp, amp_incr, dsp_i);
       return dsp_i;
       }
 
@@ -415,8 +406,6 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
       Phase dsp_phase_incr; // end_phase;
       short int *dsp_data = voice->sample->data;
       float *dsp_buf = voice->dsp_buf;
-      float dsp_amp = voice->amp;
-      float dsp_amp_incr = voice->amp_incr;
       unsigned int dsp_i = 0;
       unsigned int dsp_phase_index;
       unsigned int start_index, end_index;
@@ -472,7 +461,7 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
             for ( ; dsp_phase_index == start_index && dsp_i < n; dsp_i++) {
                   coeffs = sinc_table7[fluid_phase_fract_to_tablerow (dsp_phase)];
 
-                  dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * (float)start_points[2]
+                  dsp_buf[dsp_i] = (coeffs[0] * (float)start_points[2]
                         + coeffs[1] * (float)start_points[1]
 	                  + coeffs[2] * (float)start_points[0]
                         + coeffs[3] * (float)dsp_data[dsp_phase_index]
@@ -480,10 +469,9 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
                         + coeffs[5] * (float)dsp_data[dsp_phase_index+2]
                         + coeffs[6] * (float)dsp_data[dsp_phase_index+3]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index();
-                  dsp_amp += dsp_amp_incr;
                   }
 
             start_index++;
@@ -492,7 +480,7 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
             for ( ; dsp_phase_index == start_index && dsp_i < n; dsp_i++) {
                   coeffs = sinc_table7[fluid_phase_fract_to_tablerow (dsp_phase)];
 
-                  dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * (float)start_points[1]
+                  dsp_buf[dsp_i] = (coeffs[0] * (float)start_points[1]
         	            + coeffs[1] * (float)start_points[0]
         	            + coeffs[2] * (float)dsp_data[dsp_phase_index-1]
         	            + coeffs[3] * (float)dsp_data[dsp_phase_index]
@@ -500,10 +488,9 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
         	            + coeffs[5] * (float)dsp_data[dsp_phase_index+2]
         	            + coeffs[6] * (float)dsp_data[dsp_phase_index+3]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index();
-                  dsp_amp += dsp_amp_incr;
                   }
 
             start_index++;
@@ -512,7 +499,7 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
             for ( ; dsp_phase_index == start_index && dsp_i < n; dsp_i++) {
                   coeffs = sinc_table7[fluid_phase_fract_to_tablerow (dsp_phase)];
 
-                  dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * (float)start_points[0]
+                  dsp_buf[dsp_i] = (coeffs[0] * (float)start_points[0]
                      + coeffs[1] * (float)dsp_data[dsp_phase_index-2]
                      + coeffs[2] * (float)dsp_data[dsp_phase_index-1]
                      + coeffs[3] * (float)dsp_data[dsp_phase_index]
@@ -520,10 +507,9 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
                      + coeffs[5] * (float)dsp_data[dsp_phase_index+2]
                      + coeffs[6] * (float)dsp_data[dsp_phase_index+3]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index();
-                  dsp_amp += dsp_amp_incr;
                   }
 
             start_index -= 2;	/* set back to original start index */
@@ -532,7 +518,7 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
             for ( ; dsp_i < n && dsp_phase_index <= end_index; dsp_i++) {
                   coeffs = sinc_table7[fluid_phase_fract_to_tablerow (dsp_phase)];
 
-                  dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * (float)dsp_data[dsp_phase_index-3]
+                  dsp_buf[dsp_i] = (coeffs[0] * (float)dsp_data[dsp_phase_index-3]
                      + coeffs[1] * (float)dsp_data[dsp_phase_index-2]
                      + coeffs[2] * (float)dsp_data[dsp_phase_index-1]
                      + coeffs[3] * (float)dsp_data[dsp_phase_index]
@@ -540,10 +526,9 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
                      + coeffs[5] * (float)dsp_data[dsp_phase_index+2]
                      + coeffs[6] * (float)dsp_data[dsp_phase_index+3]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index();
-                  dsp_amp += dsp_amp_incr;
                   }
 
             /* break out if buffer filled */
@@ -556,7 +541,7 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
             for (; dsp_phase_index <= end_index && dsp_i < n; dsp_i++) {
                   coeffs = sinc_table7[fluid_phase_fract_to_tablerow (dsp_phase)];
 
-                  dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * (float)dsp_data[dsp_phase_index-3]
+                  dsp_buf[dsp_i] = (coeffs[0] * (float)dsp_data[dsp_phase_index-3]
                         + coeffs[1] * (float)dsp_data[dsp_phase_index-2]
                         + coeffs[2] * (float)dsp_data[dsp_phase_index-1]
                         + coeffs[3] * (float)dsp_data[dsp_phase_index]
@@ -564,10 +549,9 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
                         + coeffs[5] * (float)dsp_data[dsp_phase_index+2]
                         + coeffs[6] * (float)end_points[0]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index();
-                  dsp_amp += dsp_amp_incr;
                   }
 
             end_index++;	/* we're now interpolating the 2nd to last point */
@@ -576,7 +560,7 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
             for (; dsp_phase_index <= end_index && dsp_i < n; dsp_i++) {
                   coeffs = sinc_table7[fluid_phase_fract_to_tablerow (dsp_phase)];
 
-                  dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * (float)dsp_data[dsp_phase_index-3]
+                  dsp_buf[dsp_i] = (coeffs[0] * (float)dsp_data[dsp_phase_index-3]
                         + coeffs[1] * (float)dsp_data[dsp_phase_index-2]
                         + coeffs[2] * (float)dsp_data[dsp_phase_index-1]
                         + coeffs[3] * (float)dsp_data[dsp_phase_index]
@@ -584,10 +568,9 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
                         + coeffs[5] * (float)end_points[0]
                         + coeffs[6] * (float)end_points[1]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index();
-                  dsp_amp += dsp_amp_incr;
                   }
 
             end_index++;	/* we're now interpolating the last point */
@@ -596,7 +579,7 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
             for (; dsp_phase_index <= end_index && dsp_i < n; dsp_i++) {
                   coeffs = sinc_table7[fluid_phase_fract_to_tablerow (dsp_phase)];
 
-                  dsp_buf[dsp_i] = dsp_amp * (coeffs[0] * (float)dsp_data[dsp_phase_index-3]
+                  dsp_buf[dsp_i] = (coeffs[0] * (float)dsp_data[dsp_phase_index-3]
                         + coeffs[1] * (float)dsp_data[dsp_phase_index-2]
                         + coeffs[2] * (float)dsp_data[dsp_phase_index-1]
                         + coeffs[3] * (float)dsp_data[dsp_phase_index]
@@ -604,10 +587,9 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
                         + coeffs[5] * (float)end_points[1]
                         + coeffs[6] * (float)end_points[2]);
 
-                  /* increment phase and amplitude */
+                  /* increment phase */
                   dsp_phase += dsp_phase_incr;
                   dsp_phase_index = dsp_phase.index();
-                  dsp_amp += dsp_amp_incr;
                   }
 
             if (!looping)
@@ -637,7 +619,7 @@ int Voice::dsp_float_interpolate_7th_order(unsigned n)
       dsp_phase -= (Phase)0x80000000;
 
       voice->phase = dsp_phase;
-      voice->amp   = dsp_amp;
+      voice->amp   = Mix::ramp(dsp_buf, voice->amp, voice->amp_incr, dsp_i);
 
       return dsp_i;
       }
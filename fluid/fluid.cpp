@@ -25,6 +25,8 @@
 #include "gen.h"
 #include "chorus.h"
 #include "voice.h"
+#include "mix.h"
+#include "loader.h"
 #include "libmscore/sparm_p.h"
 
 namespace FluidS {
@@ -35,6 +37,7 @@ namespace FluidS {
  */
 
 bool Fluid::initialized = false;
+QString Fluid::_sampleCacheDir;
 
 /* default modulators
  * SF2.01 page 52 ff:
@@ -76,6 +79,8 @@ static SyntiParameter params[] = {
       SyntiParameter(SParmId(FLUID_ID, CHORUS_GROUP, CHORUS_DEPTH).val, "ChoDepth",       0.0),
       SyntiParameter(SParmId(FLUID_ID, CHORUS_GROUP, CHORUS_BLOCKS).val, "ChoBlocks",     0.0),
       SyntiParameter(SParmId(FLUID_ID, CHORUS_GROUP, CHORUS_GAIN).val, "ChoGain",         0.0),
+
+      SyntiParameter(SParmId(FLUID_ID, INTERP_GROUP, 0).val, "Interpolation", FLUID_INTERP_DEFAULT),
       };
 
 //---------------------------------------------------------
@@ -90,7 +95,9 @@ Fluid::Fluid()
       fx_buf[1] = new float[FLUID_MAX_BUFSIZE];
       reverb    = 0;
       chorus    = 0;
+      _interpMethod = FLUID_INTERP_DEFAULT;
       silentBlocks = 0;
+      loader    = 0;
       }
 
 //---------------------------------------------------------
@@ -103,6 +110,7 @@ void Fluid::init()
       initialized = true;
       fluid_conversion_config();
       Voice::dsp_float_config();
+      Mix::init();
       }
 
 //---------------------------------------------------------
@@ -112,8 +120,13 @@ void Fluid::init()
 
 void Fluid::init(int sr)
       {
+      {
+      // synthesizers may be created on several threads (audio export)
+      static QMutex initMutex;
+      QMutexLocker locker(&initMutex);
       if (!initialized) // initialize all the conversion tables and other stuff
             init();
+      }
 
       sample_rate        = double(sr);
       sfont_id           = 0;
@@ -140,6 +153,7 @@ void Fluid::init(int sr)
 Fluid::~Fluid()
       {
       _state = FLUID_SYNTH_STOPPED;
+      delete loader;
       foreach(Voice* v, activeVoices)
             delete v;
       foreach(Voice* v, freeVoices)
@@ -479,6 +493,37 @@ void Fluid::program_reset()
             program_change(i, channel[i]->getPrognum());
       }
 
+//---------------------------------------------------------
+//   setAsyncLoading
+//    if enabled, samples of presets selected by program
+//    changes are loaded by a background thread; notes
+//    played before the samples are available are skipped
+//---------------------------------------------------------
+
+void Fluid::setAsyncLoading(bool val)
+      {
+      if (val == (loader != 0))
+            return;
+      if (val)
+            loader = new SampleLoader;
+      else {
+            delete loader;
+            loader = 0;
+            }
+      }
+
+//---------------------------------------------------------
+//   loadSamples
+//---------------------------------------------------------
+
+void Fluid::loadSamples(Preset* p)
+      {
+      if (loader)
+            loader->load(p);
+      else
+            p->loadSamples();
+      }
+
 //---------------------------------------------------------
 //   process
 //---------------------------------------------------------
@@ -507,10 +552,7 @@ void Fluid::process(unsigned len, float* out, float gain)
                   }
             mutex.unlock();
             }
-      for (unsigned i = 0; i < len; i++) {
-            *out++ += gain * left_buf[i];
-            *out++ += gain * right_buf[i];
-            }
+      Mix::interleave(out, left_buf, right_buf, gain, len);
       }
 
 /*
@@ -801,6 +843,8 @@ bool Fluid::sfunload(int id, bool reset_presets)
             return false;
             }
 
+      if (loader)
+            loader->clear();  // the loader may still reference presets of sf
       sfonts.removeAll(sf);   // remove the SoundFont from the list
 
       /* reset the presets for all channels */
@@ -871,11 +915,25 @@ SFont* Fluid::get_sfont_by_name(const QString& name)
 //---------------------------------------------------------
 //   set_interp_method
 //    Sets the interpolation method to use on channel chan.
-//    If chan is < 0, then set the interpolation method on all channels.
+//    If chan is < 0, then set the interpolation method on all channels
+//    and make it the default for channels created later.
+//    Voices pick up the method of their channel at note on.
 //---------------------------------------------------------
 
 void Fluid::set_interp_method(int chan, int interp_method)
       {
+      switch (interp_method) {
+            case FLUID_INTERP_NONE:
+            case FLUID_INTERP_LINEAR:
+            case FLUID_INTERP_4THORDER:
+            case FLUID_INTERP_7THORDER:
+                  break;
+            default:
+                  qDebug("Fluid: invalid interpolation method %d\n", interp_method);
+                  return;
+            }
+      if (chan < 0)
+            _interpMethod = interp_method;
       foreach(Channel* c, channel) {
             if (chan < 0 || c->getNum() == chan)
                   c->setInterpMethod(interp_method);
@@ -1000,6 +1058,8 @@ SyntiParameter Fluid::parameter(int id) const
                         params[i].set(reverb->parameter(no));
                   else if (group == CHORUS_GROUP)
                         params[i].set(chorus->parameter(no));
+                  else if (group == INTERP_GROUP)
+                        params[i].set(_interpMethod);
                   return params[i];
                   }
             }
@@ -1021,6 +1081,8 @@ void Fluid::setParameter(int id, double value)
             reverb->setParameter(spid.paramId, value);
       else if (spid.subsystemId == CHORUS_GROUP)
             chorus->setParameter(spid.paramId, value);
+      else if (spid.subsystemId == INTERP_GROUP)
+            set_interp_method(-1, lrint(value));
       }
 
 /**
@@ -1068,6 +1130,8 @@ SyntiState Fluid::state() const
                   params[i].set(reverb->parameter(no));
             else if (group == CHORUS_GROUP)
                   params[i].set(chorus->parameter(no));
+            else if (group == INTERP_GROUP)
+                  params[i].set(_interpMethod);
             else
                   printf("Fluid::state: unknown group %d\n", group);
             sp.append(params[i]);
@@ -1128,6 +1192,8 @@ void Fluid::setState(SyntiState& sp)
                   reverb->setParameter(no, p.fval());
             else if (group == CHORUS_GROUP)
                   chorus->setParameter(no, p.fval());
+            else if (group == INTERP_GROUP)
+                  set_interp_method(-1, lrint(p.fval()));
             else
                   printf("Fluid::setState: unknown group %d\n", group);
             }
@@ -37,6 +37,7 @@ struct Mod;
 class Reverb;
 class Chorus;
 class Fluid;
+class SampleLoader;
 
 #define FLUID_MAX_BUFSIZE       4096
 #define FLUID_NUM_PROGRAMS      129
@@ -291,7 +292,8 @@ class Channel {
 enum {
       FLUID_GROUP  = 0,
       REVERB_GROUP = 1,
-      CHORUS_GROUP = 2
+      CHORUS_GROUP = 2,
+      INTERP_GROUP = 3
       };
 
 enum {
@@ -327,6 +329,7 @@ class Fluid : public Synth {
 
       static bool initialized;
       static void init();
+      static QString _sampleCacheDir;
 
       double sample_rate;                 // The sample rate
       float _masterTuning;                // usually 440.0
@@ -335,12 +338,16 @@ class Fluid : public Synth {
       QMutex mutex;
       void updatePatchList();
 
+      SampleLoader* loader;               // 0 if samples are loaded synchronously
+      QAtomicInt _skippedVoices;          // voices not started, sample not loaded
+
    protected:
       int _state;                         // the synthesizer state
 
       unsigned int sfont_id;
 
       double _gain;                       // master gain
+      int _interpMethod;                  // default interpolation for new channels
       QList<Channel*> channel;            // the channels
 
       unsigned int noteid;                // the id is incremented for every new note. it's used for noteoff's
@@ -409,6 +416,18 @@ class Fluid : public Synth {
       float get_gen(int chan, int param);
       void set_gen(int chan, int param, float value);
       void set_interp_method(int chan, int interp_method);
+      int interpMethod() const            { return _interpMethod; }
+
+      // load preset samples in the background; notes whose
+      // samples are not loaded yet are skipped and counted
+      virtual void setAsyncLoading(bool);
+      void loadSamples(Preset*);
+      void voiceSkipped()                 { _skippedVoices.fetchAndAddRelaxed(1); }
+      virtual int skippedVoices() const   { return int(_skippedVoices); }
+
+      // directory for decoded SF3 samples; empty disables the cache
+      static void setSampleCacheDir(const QString& s) { _sampleCacheDir = s;    }
+      static QString sampleCacheDir()                 { return _sampleCacheDir; }
 
       Preset* get_channel_preset(int chan) const { return channel[chan]->preset(); }
 
@@ -0,0 +1,100 @@
+//=============================================================================
+//  MuseScore
+//  Linux Music Score Editor
+//
+//  Copyright (C) 2012 Werner Schweer and others
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//=============================================================================
+
+#include "loader.h"
+#include "sfont.h"
+
+namespace FluidS {
+
+//---------------------------------------------------------
+//   SampleLoader
+//---------------------------------------------------------
+
+SampleLoader::SampleLoader()
+      {
+      current = 0;
+      quit    = false;
+      start(QThread::LowPriority);
+      }
+
+SampleLoader::~SampleLoader()
+      {
+      mutex.lock();
+      queue.clear();
+      quit = true;
+      wake.wakeOne();
+      mutex.unlock();
+      wait();
+      }
+
+//---------------------------------------------------------
+//   load
+//    queue the samples of preset p for loading; called
+//    from the audio thread, the lock is only held for
+//    the queue update
+//---------------------------------------------------------
+
+void SampleLoader::load(Preset* p)
+      {
+      QMutexLocker locker(&mutex);
+      if (p != current && !queue.contains(p)) {
+            queue.append(p);
+            wake.wakeOne();
+            }
+      }
+
+//---------------------------------------------------------
+//   clear
+//    drop all pending requests and wait for the current
+//    one; must be called before presets are deleted
+//---------------------------------------------------------
+
+void SampleLoader::clear()
+      {
+      QMutexLocker locker(&mutex);
+      queue.clear();
+      while (current)
+            done.wait(&mutex);
+      }
+
+//---------------------------------------------------------
+//   run
+//---------------------------------------------------------
+
+void SampleLoader::run()
+      {
+      mutex.lock();
+      for (;;) {
+            while (queue.isEmpty() && !quit)
+                  wake.wait(&mutex);
+            if (quit)
+                  break;
+            current = queue.takeFirst();
+            mutex.unlock();
+
+            current->loadSamples();
+
+            mutex.lock();
+            current = 0;
+            done.wakeAll();
+            }
+      mutex.unlock();
+      }
+
+}
@@ -0,0 +1,52 @@
+//=============================================================================
+//  MuseScore
+//  Linux Music Score Editor
+//
+//  Copyright (C) 2012 Werner Schweer and others
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//=============================================================================
+
+#ifndef __FLUID_LOADER_H__
+#define __FLUID_LOADER_H__
+
+namespace FluidS {
+
+class Preset;
+
+//---------------------------------------------------------
+//   SampleLoader
+//    loads the samples of presets on a background thread,
+//    so that program changes sent from the audio thread
+//    never wait for the disk or the Vorbis decoder
+//---------------------------------------------------------
+
+class SampleLoader : public QThread {
+      QMutex mutex;
+      QWaitCondition wake;          // new request or quit
+      QWaitCondition done;          // current request finished
+      QList<Preset*> queue;
+      Preset* current;
+      bool quit;
+
+      virtual void run();
+
+   public:
+      SampleLoader();
+      ~SampleLoader();
+      void load(Preset*);
+      void clear();
+      };
+
+}
+#endif
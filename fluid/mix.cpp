@@ -0,0 +1,238 @@
+//=============================================================================
+//  MuseScore
+//  Linux Music Score Editor
+//
+//  Copyright (C) 2012 Werner Schweer and others
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//=============================================================================
+
+#include "mix.h"
+
+//
+// The SIMD kernels need target attributes on functions using
+// <immintrin.h> intrinsics and the cpu detection builtins.
+// gcc has them from 4.9 on, clang reports them by
+// __has_builtin. Older compilers (gcc 4.4 of the Qt SDK on
+// MinGW and mac) use the scalar kernels.
+//
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__clang__)
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_cpu_supports)
+#define FLUID_X86_SIMD
+#endif
+#endif
+#elif defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define FLUID_X86_SIMD
+#endif
+#endif
+
+#ifdef FLUID_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace FluidS {
+
+//---------------------------------------------------------
+//   scalar kernels
+//---------------------------------------------------------
+
+static void addScalar(float* dst, const float* src, float amp, int n)
+      {
+      for (int i = 0; i < n; ++i)
+            dst[i] += amp * src[i];
+      }
+
+static void add2Scalar(float* d1, float* d2, const float* src, float a1, float a2, int n)
+      {
+      for (int i = 0; i < n; ++i) {
+            float v = src[i];
+            d1[i] += a1 * v;
+            d2[i] += a2 * v;
+            }
+      }
+
+static void interleaveScalar(float* out, const float* left, const float* right, float gain, int n)
+      {
+      for (int i = 0; i < n; ++i) {
+            *out++ += gain * left[i];
+            *out++ += gain * right[i];
+            }
+      }
+
+static float rampScalar(float* buf, float amp, float incr, int n)
+      {
+      for (int i = 0; i < n; ++i) {
+            buf[i] *= amp;
+            amp += incr;
+            }
+      return amp;
+      }
+
+#ifdef FLUID_X86_SIMD
+
+//---------------------------------------------------------
+//   SSE2 kernels
+//---------------------------------------------------------
+
+__attribute__((target("sse2")))
+static void addSSE2(float* dst, const float* src, float amp, int n)
+      {
+      __m128 a = _mm_set1_ps(amp);
+      int i = 0;
+      for (; i + 4 <= n; i += 4) {
+            __m128 d = _mm_loadu_ps(dst + i);
+            _mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(a, _mm_loadu_ps(src + i))));
+            }
+      addScalar(dst + i, src + i, amp, n - i);
+      }
+
+__attribute__((target("sse2")))
+static void add2SSE2(float* d1, float* d2, const float* src, float a1, float a2, int n)
+      {
+      __m128 va1 = _mm_set1_ps(a1);
+      __m128 va2 = _mm_set1_ps(a2);
+      int i = 0;
+      for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(src + i);
+            _mm_storeu_ps(d1 + i, _mm_add_ps(_mm_loadu_ps(d1 + i), _mm_mul_ps(va1, v)));
+            _mm_storeu_ps(d2 + i, _mm_add_ps(_mm_loadu_ps(d2 + i), _mm_mul_ps(va2, v)));
+            }
+      add2Scalar(d1 + i, d2 + i, src + i, a1, a2, n - i);
+      }
+
+__attribute__((target("sse2")))
+static void interleaveSSE2(float* out, const float* left, const float* right, float gain, int n)
+      {
+      __m128 g = _mm_set1_ps(gain);
+      int i = 0;
+      for (; i + 4 <= n; i += 4) {
+            __m128 l  = _mm_mul_ps(g, _mm_loadu_ps(left + i));
+            __m128 r  = _mm_mul_ps(g, _mm_loadu_ps(right + i));
+            float* o  = out + i * 2;
+            _mm_storeu_ps(o,     _mm_add_ps(_mm_loadu_ps(o),     _mm_unpacklo_ps(l, r)));
+            _mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_unpackhi_ps(l, r)));
+            }
+      interleaveScalar(out + i * 2, left + i, right + i, gain, n - i);
+      }
+
+__attribute__((target("sse2")))
+static float rampSSE2(float* buf, float amp, float incr, int n)
+      {
+      __m128 a    = _mm_add_ps(_mm_set1_ps(amp),
+         _mm_mul_ps(_mm_set1_ps(incr), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f)));
+      __m128 step = _mm_set1_ps(incr * 4.0f);
+      int i = 0;
+      for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(buf + i, _mm_mul_ps(a, _mm_loadu_ps(buf + i)));
+            a = _mm_add_ps(a, step);
+            }
+      return rampScalar(buf + i, amp + i * incr, incr, n - i);
+      }
+
+//---------------------------------------------------------
+//   AVX2 kernels
+//---------------------------------------------------------
+
+__attribute__((target("avx2")))
+static void addAVX2(float* dst, const float* src, float amp, int n)
+      {
+      __m256 a = _mm256_set1_ps(amp);
+      int i = 0;
+      for (; i + 8 <= n; i += 8) {
+            __m256 d = _mm256_loadu_ps(dst + i);
+            _mm256_storeu_ps(dst + i, _mm256_add_ps(d, _mm256_mul_ps(a, _mm256_loadu_ps(src + i))));
+            }
+      addScalar(dst + i, src + i, amp, n - i);
+      }
+
+__attribute__((target("avx2")))
+static void add2AVX2(float* d1, float* d2, const float* src, float a1, float a2, int n)
+      {
+      __m256 va1 = _mm256_set1_ps(a1);
+      __m256 va2 = _mm256_set1_ps(a2);
+      int i = 0;
+      for (; i + 8 <= n; i += 8) {
+            __m256 v = _mm256_loadu_ps(src + i);
+            _mm256_storeu_ps(d1 + i, _mm256_add_ps(_mm256_loadu_ps(d1 + i), _mm256_mul_ps(va1, v)));
+            _mm256_storeu_ps(d2 + i, _mm256_add_ps(_mm256_loadu_ps(d2 + i), _mm256_mul_ps(va2, v)));
+            }
+      add2Scalar(d1 + i, d2 + i, src + i, a1, a2, n - i);
+      }
+
+__attribute__((target("avx2")))
+static void interleaveAVX2(float* out, const float* left, const float* right, float gain, int n)
+      {
+      __m256 g = _mm256_set1_ps(gain);
+      int i = 0;
+      for (; i + 8 <= n; i += 8) {
+            __m256 l  = _mm256_mul_ps(g, _mm256_loadu_ps(left + i));
+            __m256 r  = _mm256_mul_ps(g, _mm256_loadu_ps(right + i));
+            // unpack works within 128 bit lanes: lo = l0 r0 l1 r1 | l4 r4 l5 r5
+            __m256 lo = _mm256_unpacklo_ps(l, r);
+            __m256 hi = _mm256_unpackhi_ps(l, r);
+            float* o  = out + i * 2;
+            _mm256_storeu_ps(o,     _mm256_add_ps(_mm256_loadu_ps(o),
+               _mm256_permute2f128_ps(lo, hi, 0x20)));
+            _mm256_storeu_ps(o + 8, _mm256_add_ps(_mm256_loadu_ps(o + 8),
+               _mm256_permute2f128_ps(lo, hi, 0x31)));
+            }
+      interleaveScalar(out + i * 2, left + i, right + i, gain, n - i);
+      }
+
+__attribute__((target("avx2")))
+static float rampAVX2(float* buf, float amp, float incr, int n)
+      {
+      __m256 a    = _mm256_add_ps(_mm256_set1_ps(amp), _mm256_mul_ps(_mm256_set1_ps(incr),
+         _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f)));
+      __m256 step = _mm256_set1_ps(incr * 8.0f);
+      int i = 0;
+      for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(buf + i, _mm256_mul_ps(a, _mm256_loadu_ps(buf + i)));
+            a = _mm256_add_ps(a, step);
+            }
+      return rampScalar(buf + i, amp + i * incr, incr, n - i);
+      }
+
+#endif
+
+void (*Mix::add)(float*, const float*, float, int)                       = addScalar;
+void (*Mix::add2)(float*, float*, const float*, float, float, int)       = add2Scalar;
+void (*Mix::interleave)(float*, const float*, const float*, float, int)  = interleaveScalar;
+float (*Mix::ramp)(float*, float, float, int)                            = rampScalar;
+
+//---------------------------------------------------------
+//   init
+//    select the fastest kernels the cpu supports
+//---------------------------------------------------------
+
+void Mix::init()
+      {
+#ifdef FLUID_X86_SIMD
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2")) {
+            add        = addAVX2;
+            add2       = add2AVX2;
+            interleave = interleaveAVX2;
+            ramp       = rampAVX2;
+            }
+      else if (__builtin_cpu_supports("sse2")) {
+            add        = addSSE2;
+            add2       = add2SSE2;
+            interleave = interleaveSSE2;
+            ramp       = rampSSE2;
+            }
+#endif
+      }
+}
@@ -0,0 +1,46 @@
+//=============================================================================
+//  MuseScore
+//  Linux Music Score Editor
+//
+//  Copyright (C) 2012 Werner Schweer and others
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//=============================================================================
+
+#ifndef __FLUID_MIX_H__
+#define __FLUID_MIX_H__
+
+namespace FluidS {
+
+//---------------------------------------------------------
+//   Mix
+//    accumulation kernels used by Voice::effects() and
+//    Fluid::process(); the implementation (scalar, SSE2
+//    or AVX2) is selected at runtime by Mix::init()
+//---------------------------------------------------------
+
+struct Mix {
+      // dst[i] += amp * src[i]
+      static void (*add)(float* dst, const float* src, float amp, int n);
+      // d1[i] += a1 * src[i]; d2[i] += a2 * src[i]
+      static void (*add2)(float* d1, float* d2, const float* src, float a1, float a2, int n);
+      // out[2*i] += gain * left[i]; out[2*i+1] += gain * right[i]
+      static void (*interleave)(float* out, const float* left, const float* right, float gain, int n);
+      // buf[i] *= amp + i * incr; returns amp + n * incr
+      static float (*ramp)(float* buf, float amp, float incr, int n);
+
+      static void init();
+      };
+
+}
+#endif
@@ -43,6 +43,90 @@ SFVersion::SFVersion()
       minor = 0;
       }
 
+//---------------------------------------------------------
+//   SampleStore
+//---------------------------------------------------------
+
+QMutex SampleStore::mutex;
+QHash<QString, SampleStore*> SampleStore::stores;
+
+SampleStore::SampleStore(const QString& k, const QString& path)
+   : key(k), file(path)
+      {
+      _data    = 0;
+      refCount = 0;
+      if (file.open(QIODevice::ReadOnly))
+            _data = file.map(0, file.size());
+      if (_data == 0)
+            file.close();
+      }
+
+SampleStore::~SampleStore()
+      {
+      if (_data)
+            file.unmap(_data);
+      file.close();
+      }
+
+//---------------------------------------------------------
+//   acquire
+//    return the mapping of the file at path, creating it
+//    on first use; return 0 if the file cannot be mapped
+//---------------------------------------------------------
+
+SampleStore* SampleStore::acquire(const QString& path)
+      {
+      QFileInfo fi(path);
+      // a file replaced on disk gets a new mapping; SFont
+      // objects still using the old one keep it alive
+      QString k = QString("%1:%2:%3").arg(fi.canonicalFilePath())
+         .arg(fi.size()).arg(fi.lastModified().toTime_t());
+
+      QMutexLocker locker(&mutex);
+      SampleStore* s = stores.value(k);
+      if (s == 0) {
+            s = new SampleStore(k, path);
+            if (s->_data == 0) {
+                  delete s;
+                  return 0;
+                  }
+            stores.insert(k, s);
+            }
+      ++s->refCount;
+      return s;
+      }
+
+//---------------------------------------------------------
+//   hash
+//    md5 of the file contents; computed on first use
+//---------------------------------------------------------
+
+QString SampleStore::hash()
+      {
+      QMutexLocker locker(&mutex);
+      if (_hash.isEmpty()) {
+            QByteArray md5 = QCryptographicHash::hash(
+               QByteArray::fromRawData((const char*)_data, size()), QCryptographicHash::Md5);
+            _hash = md5.toHex();
+            }
+      return _hash;
+      }
+
+//---------------------------------------------------------
+//   release
+//---------------------------------------------------------
+
+void SampleStore::release(SampleStore* s)
+      {
+      if (s == 0)
+            return;
+      QMutexLocker locker(&mutex);
+      if (--s->refCount == 0) {
+            stores.remove(s->key);
+            delete s;
+            }
+      }
+
 //---------------------------------------------------------
 //   SFont
 //---------------------------------------------------------
@@ -50,6 +134,7 @@ SFVersion::SFVersion()
 SFont::SFont(Fluid* f)
       {
       synth      = f;
+      store      = 0;
       samplepos  = 0;
       samplesize = 0;
       }
@@ -67,6 +152,32 @@ SFont::~SFont()
 //                  delete z;
             delete i;
             }
+      // samples may point into the mapping
+      SampleStore::release(store);
+      }
+
+//---------------------------------------------------------
+//   sampleData
+//    return the start of the sample chunk in the shared
+//    file mapping or 0 if the file is not mapped
+//---------------------------------------------------------
+
+const uchar* SFont::sampleData() const
+      {
+      if (store == 0 || qint64(samplepos) + samplesize > store->size())
+            return 0;
+      return store->data() + samplepos;
+      }
+
+//---------------------------------------------------------
+//   hash
+//    identifies the file contents in the sample cache;
+//    empty if the file is not mapped
+//---------------------------------------------------------
+
+QString SFont::hash() const
+      {
+      return store ? store->hash() : QString();
       }
 
 //---------------------------------------------------------
@@ -127,6 +238,25 @@ Preset::~Preset()
             delete z;
       }
 
+//---------------------------------------------------------
+//   addSample
+//---------------------------------------------------------
+
+static void addSample(QList<Sample*>* sl, Sample* s)
+      {
+      if (s && s->valid() && !s->data && !sl->contains(s))
+            sl->append(s);
+      }
+
+//---------------------------------------------------------
+//   loadSample
+//---------------------------------------------------------
+
+static void loadSample(Sample* s)
+      {
+      s->load();
+      }
+
 //---------------------------------------------------------
 //   loadSamples
 //    this is called if the preset is associated with a
@@ -135,23 +265,40 @@ Preset::~Preset()
 
 void Preset::loadSamples()
       {
-//      sfont->synth->mutex.lock();
+      QList<Sample*> sl;
       if (_global_zone && _global_zone->instrument) {
             Instrument* i = _global_zone->instrument;
-            if (i->global_zone && i->global_zone->sample)
-                  i->global_zone->sample->load();
+            if (i->global_zone)
+                  addSample(&sl, i->global_zone->sample);
             foreach(Zone* iz, i->zones)
-                  iz->sample->load();
+                  addSample(&sl, iz->sample);
             }
 
       foreach(Zone* z, zones) {
             Instrument* i = z->instrument;
-            if (i->global_zone && i->global_zone->sample)
-                  i->global_zone->sample->load();
+            if (i->global_zone)
+                  addSample(&sl, i->global_zone->sample);
             foreach(Zone* iz, i->zones)
-                  iz->sample->load();
+                  addSample(&sl, iz->sample);
+            }
+
+      //
+      // decoding compressed samples is expensive, so do it
+      // concurrently; uncompressed samples only map the file
+      //
+      bool compressed = false;
+      foreach(Sample* s, sl) {
+            if (s->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS) {
+                  compressed = true;
+                  break;
+                  }
+            }
+      if (compressed && sl.size() > 1)
+            QtConcurrent::blockingMap(sl, loadSample);
+      else {
+            foreach(Sample* s, sl)
+                  s->load();
             }
-//      sfont->synth->mutex.unlock();
       }
 
 //---------------------------------------------------------
@@ -183,6 +330,11 @@ bool Preset::noteon(Fluid* synth, unsigned id, int chan, int key, int vel, doubl
                         /* check if the note falls into the key and velocity range of this
                            instrument */
                         if (inst_zone->inside_range(key, vel) && (sample != 0)) {
+                              if (!sample->loaded()) {
+                                    // not (yet) loaded by the sample loader
+                                    synth->voiceSkipped();
+                                    continue;
+                                    }
 
                               /* this is a good zone. allocate a new synthesis process and
                                  initialize it */
@@ -584,6 +736,7 @@ Sample::Sample(SFont* s)
       pitchadj    = 0;
       sampletype  = 0;
       data        = 0;
+      ownData     = true;
       amplitude_that_reaches_noise_floor_is_valid = false;
       amplitude_that_reaches_noise_floor = 0.0;
       }
@@ -594,7 +747,8 @@ Sample::Sample(SFont* s)
 
 Sample::~Sample()
       {
-      delete[] data;
+      if (ownData)
+            delete[] data;
       }
 
 //---------------------------------------------------------
@@ -605,31 +759,66 @@ void Sample::load()
       {
       if (!_valid || data)
             return;
-      QFile fd(sf->get_name());
-      if (!fd.open(QIODevice::ReadOnly))
-            return;
-      if (sampletype & FLUID_SAMPLETYPE_OGG_VORBIS) {
-            if (!fd.seek(sf->samplePos() + start))
-                  return;
-            }
-      else {
-            if (!fd.seek(sf->samplePos() + start * sizeof(short)))
-                  return;
-            }
       unsigned int size = end - start;
+      const uchar* map  = sf->sampleData();
 
       if (sampletype & FLUID_SAMPLETYPE_OGG_VORBIS) {
 #ifdef SOUNDFONT3
-            char* p = new char[size];
-            if (fd.read(p, size) != size) {
-                  printf("  read %d failed\n", size);
-                  return;
+            QString cachePath;
+            QString cacheDir = Fluid::sampleCacheDir();
+            QString hash     = sf->hash();
+            if (!cacheDir.isEmpty() && !hash.isEmpty()) {
+                  cachePath = QString("%1/%2/%3.pcm").arg(cacheDir).arg(hash).arg(start);
+                  if (readCache(cachePath)) {
+                        optimize();
+                        _loaded.fetchAndStoreRelease(1);
+                        return;
+                        }
                   }
-            decompressOggVorbis(p, size);
-            delete[] p;
+            bool ok;
+            if (map) {
+                  if (end > sf->getSamplesize())
+                        return;
+                  ok = decompressOggVorbis((char*)map + start, size);
+                  }
+            else {
+                  QFile fd(sf->get_name());
+                  if (!fd.open(QIODevice::ReadOnly) || !fd.seek(sf->samplePos() + start))
+                        return;
+                  char* p = new char[size];
+                  if (fd.read(p, size) != size) {
+                        printf("  read %d failed\n", size);
+                        delete[] p;
+                        return;
+                        }
+                  ok = decompressOggVorbis(p, size);
+                  delete[] p;
+                  }
+            if (!ok)
+                  _valid = false;
+            else if (_valid && !cachePath.isEmpty())
+                  writeCache(cachePath);
 #endif
+            optimize();
+            if (_valid && data)
+                  _loaded.fetchAndStoreRelease(1);
+            return;
+            }
+
+      if (map && QSysInfo::ByteOrder == QSysInfo::LittleEndian) {
+            //
+            // the sample format matches the file format, so use
+            // the shared mapping directly; it is read only
+            //
+            if (end * sizeof(short) > sf->getSamplesize())
+                  return;
+            data    = (short*)(map) + start;
+            ownData = false;
             }
       else {
+            QFile fd(sf->get_name());
+            if (!fd.open(QIODevice::ReadOnly) || !fd.seek(sf->samplePos() + start * sizeof(short)))
+                  return;
             data = new short[size];
             size *= sizeof(short);
 
@@ -648,12 +837,13 @@ void Sample::load()
                         data[i] = s;
                         }
                   }
-            end       -= (start + 1);       // marks last sample, contrary to SF spec.
-            loopstart -= start;
-            loopend   -= start;
-            start      = 0;
             }
+      end       -= (start + 1);       // marks last sample, contrary to SF spec.
+      loopstart -= start;
+      loopend   -= start;
+      start      = 0;
       optimize();
+      _loaded.fetchAndStoreRelease(1);
       }
 
 //---------------------------------------------------------
@@ -759,6 +949,7 @@ bool SFont::load()
             return false;
             }
       f.close();
+      store = SampleStore::acquire(f.fileName());
       /* sort preset list by bank, preset # */
       qSort(presets.begin(), presets.end(), preset_compare);
       return true;
@@ -45,6 +45,35 @@ struct SFVersion {            // version structure
       SFVersion();
       };
 
+//---------------------------------------------------------
+//   SampleStore
+//    read only memory mapping of a SoundFont file; shared
+//    by all SFont objects (of all Fluid instances) which
+//    load the same file
+//---------------------------------------------------------
+
+class SampleStore {
+      QString key;
+      QFile file;
+      uchar* _data;
+      int refCount;
+      QString _hash;
+
+      static QMutex mutex;
+      static QHash<QString, SampleStore*> stores;
+
+      SampleStore(const QString& key, const QString& path);
+      ~SampleStore();
+
+   public:
+      static SampleStore* acquire(const QString& path);
+      static void release(SampleStore*);
+
+      const uchar* data() const     { return _data; }
+      qint64 size() const           { return file.size(); }
+      QString hash();
+      };
+
 //---------------------------------------------------------
 //   SFont
 //---------------------------------------------------------
@@ -52,6 +81,7 @@ struct SFVersion {            // version structure
 class SFont {
       Fluid* synth;
       QFile f;
+      SampleStore* store;           // shared mapping of f, may be 0
       unsigned samplepos;           // the position in the file at which the sample data starts
       unsigned samplesize;          // the size of the sample data
 
@@ -113,6 +143,8 @@ class SFont {
       void setSamplepos(unsigned v)             { samplepos = v; }
       void setSamplesize(unsigned v)            { samplesize = v; }
       unsigned getSamplesize() const            { return samplesize; }
+      const uchar* sampleData() const;
+      QString hash() const;
       const QList<Preset*> getPresets() const   { return presets; }
       SFVersion version() const                 { return _version; }
       friend class Preset;
@@ -124,6 +156,7 @@ class SFont {
 
 class Sample {
       bool _valid;
+      mutable QAtomicInt _loaded;   // set after data and loop points are final
 
    public:
       SFont* sf;
@@ -137,6 +170,7 @@ class Sample {
       int sampletype;
 
       short* data;
+      bool ownData;           // false if data points into the SampleStore
 
       /** The amplitude, that will lower the level of the sample's loop to
           the noise floor. Needed for note turnoff optimization, will be
@@ -154,8 +188,11 @@ class Sample {
       void load();
       bool valid() const    { return _valid; }
       void setValid(bool v) { _valid = v; }
+      bool loaded() const   { return _loaded.fetchAndAddAcquire(0); }
 #ifdef SOUNDFONT3
       bool decompressOggVorbis(char* p, int size);
+      bool readCache(const QString& path);
+      void writeCache(const QString& path) const;
 #endif
       };
 
@@ -12,9 +12,9 @@ namespace FluidS {
 
 bool Sample::decompressOggVorbis(char* src, int size)
       {
-#define MAX_OUT   1024*500
-      short odata[MAX_OUT];
-      short* oPtr = odata;
+      // decoded data is usually about ten times the compressed size
+      QVector<short> odata;
+      odata.reserve(size * 10);
 
       ogg_sync_state   oy; // sync and verify incoming physical bitstream
       ogg_stream_state os; // take physical pages, weld into a logical stream of packets
@@ -159,9 +159,7 @@ bool Sample::decompressOggVorbis(char* src, int size)
                                                             val = 32767;
                                                       if (val < -32768)
                                                             val = -32768;
-                                                      *oPtr++ = val;
-                                                      if ((oPtr - odata) >= MAX_OUT)
-                                                            abort();
+                                                      odata.append(val);
                                                       }
                                                 vorbis_synthesis_read(&vd, samples);
                                                 }
@@ -188,7 +186,7 @@ bool Sample::decompressOggVorbis(char* src, int size)
       ogg_sync_clear(&oy);
 
       start = 0;
-      end   = oPtr - odata;
+      end   = odata.size();
 
       if (loopend > end ||loopstart >= loopend || loopstart <= start) {
             /* can pad loop by 8 samples and ensure at least 4 for loop (2*8+4) */
@@ -207,10 +205,84 @@ bool Sample::decompressOggVorbis(char* src, int size)
             }
 
       data = new short[end];
-      memcpy(data, odata, end * sizeof(short));
+      memcpy(data, odata.constData(), end * sizeof(short));
       end -= 1;
 
 // printf("  vorbis sample 0-%d %d %d\n", end, loopstart, loopend);
       return true;
       }
+
+//---------------------------------------------------------
+//   CacheHeader
+//    decoded samples are cached as a header followed by
+//    end + 1 samples in host byte order
+//---------------------------------------------------------
+
+struct CacheHeader {
+      quint32 magic;
+      quint32 end;
+      quint32 loopstart;
+      quint32 loopend;
+      };
+
+static const quint32 CACHE_MAGIC = 0x53463301;  // "SF3" version 1
+
+//---------------------------------------------------------
+//   readCache
+//    load decoded sample data from path; return false
+//    if there is no usable cache file
+//---------------------------------------------------------
+
+bool Sample::readCache(const QString& path)
+      {
+      QFile f(path);
+      if (!f.open(QIODevice::ReadOnly))
+            return false;
+      CacheHeader h;
+      if (f.read((char*)&h, sizeof(h)) != sizeof(h) || h.magic != CACHE_MAGIC)
+            return false;
+      qint64 n = qint64(h.end) + 1;
+      if (f.size() != qint64(sizeof(h)) + n * qint64(sizeof(short))
+         || h.loopstart >= h.loopend || h.loopend > h.end)
+            return false;
+      short* d = new short[n];
+      if (f.read((char*)d, n * sizeof(short)) != n * qint64(sizeof(short))) {
+            delete[] d;
+            return false;
+            }
+      data      = d;
+      start     = 0;
+      end       = h.end;
+      loopstart = h.loopstart;
+      loopend   = h.loopend;
+      return true;
+      }
+
+//---------------------------------------------------------
+//   writeCache
+//    save decoded sample data to path; the file is written
+//    under a temporary name first so that concurrent readers
+//    never see a partial file
+//---------------------------------------------------------
+
+void Sample::writeCache(const QString& path) const
+      {
+      QFileInfo fi(path);
+      if (!QDir().mkpath(fi.absolutePath()))
+            return;
+      QTemporaryFile f(path + ".XXXXXX");
+      if (!f.open())
+            return;
+      CacheHeader h;
+      h.magic     = CACHE_MAGIC;
+      h.end       = end;
+      h.loopstart = loopstart;
+      h.loopend   = loopend;
+      qint64 n    = (qint64(end) + 1) * sizeof(short);
+      if (f.write((const char*)&h, sizeof(h)) != sizeof(h) || f.write((const char*)data, n) != n)
+            return;
+      f.close();
+      if (QFile::rename(f.fileName(), path))
+            f.setAutoRemove(false);
+      }
 } // namespace
@@ -1127,6 +1127,8 @@ static void initBeamMetrics()
       B(0, -3,  4, 21, 5);
       }
 
+static bool beamMetricsInitialized = (initBeamMetrics(), true);
+
 //---------------------------------------------------------
 //   beamMetric1
 //    table driven
@@ -1134,12 +1136,9 @@ static void initBeamMetrics()
 
 static Bm beamMetric1(bool up, char l1, char l2)
       {
-      static int initialized = false;
-      if (!initialized) {
-            initBeamMetrics();
-            initialized = true;
-            }
-      return bMetrics[Bm::key(up, l1, l2)];
+      // the table is filled at startup (beamMetricsInitialized) and only read
+      // here, as layout may run on several threads
+      return bMetrics.value(Bm::key(up, l1, l2));
       }
 
 //---------------------------------------------------------
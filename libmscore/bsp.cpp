@@ -24,9 +24,16 @@
 class InsertItemBspTreeVisitor : public BspTreeVisitor
       {
    public:
-      const Element* item;
-
-      inline void visit(QList<const Element*> *items) { items->prepend(item); }
+      BspItem item;
+
+      // keep the leaf sorted by z; elements are mostly inserted
+      // in z order, so searching from the end is cheap
+      inline void visit(QVector<BspItem>* items) {
+            int i = items->size();
+            while (i > 0 && items->at(i-1).z > item.z)
+                  --i;
+            items->insert(i, item);
+            }
       };
 
 //---------------------------------------------------------
@@ -38,7 +45,14 @@ class RemoveItemBspTreeVisitor : public BspTreeVisitor
    public:
       const Element* item;
 
-      inline void visit(QList<const Element*> *items) { items->removeAll(item); }
+      inline void visit(QVector<BspItem>* items) {
+            for (int i = 0; i < items->size();) {
+                  if (items->at(i).element == item)
+                        items->remove(i);
+                  else
+                        ++i;
+                  }
+            }
       };
 
 //---------------------------------------------------------
@@ -48,15 +62,25 @@ class RemoveItemBspTreeVisitor : public BspTreeVisitor
 class FindItemBspTreeVisitor : public BspTreeVisitor
       {
    public:
-      QList<const Element*>* foundItems;
+      QVector<const QVector<BspItem>*>* runs;
+
+      void visit(QVector<BspItem>* items) {
+            if (!items->isEmpty())
+                  runs->append(items);
+            }
+      };
+
+//---------------------------------------------------------
+//   UpdateItemBspTreeVisitor
+//---------------------------------------------------------
 
-      void visit(QList<const Element*>* items) {
+class UpdateItemBspTreeVisitor : public BspTreeVisitor
+      {
+   public:
+      void visit(QVector<BspItem>* items) {
             for (int i = 0; i < items->size(); ++i) {
-                  const Element* item = items->at(i);
-                  if (!item->itemDiscovered) {
-                        item->itemDiscovered = 1;
-                        foundItems->prepend(item);
-                        }
+                  BspItem& item = (*items)[i];
+                  item.pos = item.element->pagePos();
                   }
             }
       };
@@ -71,6 +95,7 @@ BspTree::BspTree()
       insertVisitor = new InsertItemBspTreeVisitor;
       removeVisitor = new RemoveItemBspTreeVisitor;
       findVisitor   = new FindItemBspTreeVisitor;
+      updateVisitor = new UpdateItemBspTreeVisitor;
       depth = 0;
       }
 
@@ -79,6 +104,7 @@ BspTree::~BspTree()
       delete insertVisitor;
       delete removeVisitor;
       delete findVisitor;
+      delete updateVisitor;
       }
 
 //---------------------------------------------------------
@@ -102,7 +128,8 @@ void BspTree::initialize(const QRectF& rect, int n)
 
       nodes.resize((1 << (depth+1)) - 1);
       leaves.resize(1 << depth);
-      leaves.fill(QList<const Element*>());
+      leaves.fill(QVector<BspItem>());
+      entries.clear();
       initialize(rect, depth, 0);
       }
 
@@ -115,6 +142,7 @@ void BspTree::clear()
       leafCnt = 0;
       nodes.clear();
       leaves.clear();
+      entries.clear();
       }
 
 //---------------------------------------------------------
@@ -123,18 +151,51 @@ void BspTree::clear()
 
 void BspTree::insert(const Element* element)
       {
-      insertVisitor->item = element;
-      climbTree(insertVisitor, element->pageBoundingRect());
+      BspEntry be;
+      be.pos  = element->pagePos();
+      be.rect = element->bbox().translated(be.pos);
+      be.z    = element->z();
+      be.type = element->type();
+      entries.insert(element, be);
+      insertVisitor->item.element = element;
+      insertVisitor->item.pos     = be.pos;
+      insertVisitor->item.z       = be.z;
+      climbTree(insertVisitor, be.rect);
       }
 
 //---------------------------------------------------------
 //   remove
+//    uses the rectangle the element was inserted with;
+//    the element itself is not accessed and may already
+//    be deleted
 //---------------------------------------------------------
 
 void BspTree::remove(const Element* element)
       {
+      QHash<const Element*, BspEntry>::iterator i = entries.find(element);
+      if (i == entries.end())
+            return;
       removeVisitor->item = element;
-      climbTree(removeVisitor, element->pageBoundingRect());
+      climbTree(removeVisitor, i.value().rect);
+      entries.erase(i);
+      }
+
+//---------------------------------------------------------
+//   changed
+//    true if position, page bounding rect, stacking order
+//    or type of item differ from what it was inserted with;
+//    item then has to be removed and inserted again
+//---------------------------------------------------------
+
+bool BspTree::changed(const Element* item) const
+      {
+      QHash<const Element*, BspEntry>::const_iterator i = entries.find(item);
+      if (i == entries.end())
+            return true;
+      const BspEntry& be = i.value();
+      QPointF pos(item->pagePos());
+      return be.type != item->type() || be.z != item->z() || be.pos != pos
+         || be.rect != item->bbox().translated(pos);
       }
 
 //---------------------------------------------------------
@@ -143,10 +204,12 @@ void BspTree::remove(const Element* element)
 
 QList<const Element*> BspTree::items(const QRectF& rect)
       {
-      QList<const Element*> tmp;
-      findVisitor->foundItems = &tmp;
-      climbTree(findVisitor, rect);
-      return tmp;
+      QVector<BspItem> il = drawItems(rect);
+      QList<const Element*> l;
+      l.reserve(il.size());
+      for (int i = 0; i < il.size(); ++i)
+            l.append(il[i].element);
+      return l;
       }
 
 //---------------------------------------------------------
@@ -155,20 +218,112 @@ QList<const Element*> BspTree::items(const QRectF& rect)
 
 QList<const Element*> BspTree::items(const QPointF& pos)
       {
-      QList<const Element*> tmp;
-      findVisitor->foundItems = &tmp;
+      QVector<const QVector<BspItem>*> runs;
+      findVisitor->runs = &runs;
       climbTree(findVisitor, pos);
+      QVector<BspItem> il = mergeRuns(runs);
 
       QList<const Element*> l;
-      for (int i = 0; i < tmp.size(); ++i) {
-            const Element* e = tmp.at(i);
-            e->itemDiscovered = 0;
+      for (int i = 0; i < il.size(); ++i) {
+            const Element* e = il[i].element;
             if (e->contains(pos))
                   l.append(e);
             }
       return l;
       }
 
+//---------------------------------------------------------
+//   drawItems
+//    items touching rect, sorted by z
+//---------------------------------------------------------
+
+QVector<BspItem> BspTree::drawItems(const QRectF& rect)
+      {
+      QVector<const QVector<BspItem>*> runs;
+      findVisitor->runs = &runs;
+      climbTree(findVisitor, rect);
+      return mergeRuns(runs);
+      }
+
+//---------------------------------------------------------
+//   merge
+//    stable merge of two runs sorted by z
+//---------------------------------------------------------
+
+static QVector<BspItem> merge(const QVector<BspItem>& a, const QVector<BspItem>& b)
+      {
+      QVector<BspItem> l;
+      l.reserve(a.size() + b.size());
+      int i = 0;
+      int k = 0;
+      while (i < a.size() && k < b.size()) {
+            if (b[k].z < a[i].z)
+                  l.append(b[k++]);
+            else
+                  l.append(a[i++]);
+            }
+      while (i < a.size())
+            l.append(a[i++]);
+      while (k < b.size())
+            l.append(b[k++]);
+      return l;
+      }
+
+//---------------------------------------------------------
+//   mergeRuns
+//    Elements overlapping several leaves appear in more than
+//    one run; only the first occurrence is kept. The
+//    discovered flags used for this are cleared again
+//    before returning. The remaining runs are merged
+//    pairwise.
+//---------------------------------------------------------
+
+QVector<BspItem> BspTree::mergeRuns(const QVector<const QVector<BspItem>*>& runs) const
+      {
+      QVector<QVector<BspItem> > l;
+      for (int i = 0; i < runs.size(); ++i) {
+            const QVector<BspItem>* run = runs[i];
+            QVector<BspItem> v;
+            v.reserve(run->size());
+            for (int k = 0; k < run->size(); ++k) {
+                  const BspItem& item = run->at(k);
+                  if (!item.element->itemDiscovered) {
+                        item.element->itemDiscovered = 1;
+                        v.append(item);
+                        }
+                  }
+            if (!v.isEmpty())
+                  l.append(v);
+            }
+      for (int i = 0; i < l.size(); ++i) {
+            const QVector<BspItem>& v = l[i];
+            for (int k = 0; k < v.size(); ++k)
+                  v[k].element->itemDiscovered = 0;
+            }
+      while (l.size() > 1) {
+            QVector<QVector<BspItem> > nl;
+            for (int i = 0; i < l.size(); i += 2) {
+                  if (i + 1 < l.size())
+                        nl.append(merge(l[i], l[i+1]));
+                  else
+                        nl.append(l[i]);
+                  }
+            l = nl;
+            }
+      return l.isEmpty() ? QVector<BspItem>() : l[0];
+      }
+
+//---------------------------------------------------------
+//   updatePositions
+//    refresh the cached page positions of all items in
+//    leaves touching rect
+//---------------------------------------------------------
+
+void BspTree::updatePositions(const QRectF& rect)
+      {
+      climbTree(updateVisitor, rect);
+      }
+
 #ifndef NDEBUG
 //---------------------------------------------------------
 //   debug
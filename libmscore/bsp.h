@@ -21,9 +21,34 @@ class BspTreeVisitor;
 class InsertItemBspTreeVisitor;
 class RemoveItemBspTreeVisitor;
 class FindItemBspTreeVisitor;
+class UpdateItemBspTreeVisitor;
 
 class Element;
 
+//---------------------------------------------------------
+//   BspItem
+//    element with cached stacking order and page position
+//---------------------------------------------------------
+
+struct BspItem {
+      const Element* element;
+      QPointF pos;
+      int z;
+      };
+
+//---------------------------------------------------------
+//   BspEntry
+//    what an element was inserted with; a different
+//    element can later be allocated at the same address
+//---------------------------------------------------------
+
+struct BspEntry {
+      QRectF rect;            // page bounding rect
+      QPointF pos;
+      int z;
+      int type;               // ElementType
+      };
+
 //---------------------------------------------------------
 //   BspTree
 //    binary space partitioning
@@ -46,18 +71,19 @@ class BspTree
       void climbTree(BspTreeVisitor* visitor, const QPointF& pos, int index = 0);
       void climbTree(BspTreeVisitor* visitor, const QRectF& rect, int index = 0);
 
-      void findItems(QList<const Element*>* foundItems, const QRectF& rect, int index);
-      void findItems(QList<const Element*>* foundItems, const QPointF& pos, int index);
       QRectF rectForIndex(int index) const;
+      QVector<BspItem> mergeRuns(const QVector<const QVector<BspItem>*>& runs) const;
 
       QVector<Node> nodes;
-      QVector<QList<const Element*> > leaves;
+      QVector<QVector<BspItem> > leaves;      // sorted by z
       int leafCnt;
       QRectF rect;
+      QHash<const Element*, BspEntry> entries;
 
       InsertItemBspTreeVisitor* insertVisitor;
       RemoveItemBspTreeVisitor* removeVisitor;
       FindItemBspTreeVisitor* findVisitor;
+      UpdateItemBspTreeVisitor* updateVisitor;
 
    public:
       BspTree();
@@ -68,9 +94,16 @@ class BspTree
 
       void insert(const Element* item);
       void remove(const Element* item);
+      bool contains(const Element* item) const    { return entries.contains(item); }
+      bool changed(const Element* item) const;
+      QList<const Element*> elements() const      { return entries.keys(); }
+      int count() const                           { return entries.size(); }
+      const QRectF& bounds() const                { return rect; }
 
       QList<const Element*> items(const QRectF& rect);
       QList<const Element*> items(const QPointF& pos);
+      QVector<BspItem> drawItems(const QRectF& rect);
+      void updatePositions(const QRectF& rect);
 
       int leafCount() const                       { return leafCnt; }
       inline int firstChildIndex(int index) const { return index * 2 + 1; }
@@ -91,7 +124,7 @@ class BspTreeVisitor
       {
    public:
       virtual ~BspTreeVisitor() {}
-      virtual void visit(QList<const Element*>* items) = 0;
+      virtual void visit(QVector<BspItem>* items) = 0;
       };
 
 #endif
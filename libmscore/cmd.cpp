@@ -154,18 +154,23 @@ void Score::end2()
       {
       bool _needLayout = false;
       if (_layoutAll) {
+            invalidateEventCache();
             _updateAll  = true;
             _needLayout = true;
             startLayout = 0;
             }
       else if (startLayout) {
-            _updateAll = true;
-            _needLayout = true;
+            invalidateEventCache(startLayout, endLayout);
+            // a successful relayout adds the changed pages to the refresh area
+            _needLayout = !doReLayout();
+            if (_needLayout)
+                  _updateAll = true;
             }
       if (_needLayout)
             doLayout();
-      _layoutAll   = false;
+      _layoutAll  = false;
       startLayout = 0;
+      endLayout   = 0;
       }
 
 //---------------------------------------------------------
@@ -175,6 +180,8 @@ void Score::end2()
 void Score::end1()
       {
       if (_updateAll) {
+            foreach(Page* page, _pages)
+                  page->updatePositions(page->bbox());
             foreach(MuseScoreView* v, viewer)
                   v->updateAll();
             }
@@ -182,6 +189,11 @@ void Score::end1()
             // update a little more:
             qreal d = spatium() * .5;
             refresh.adjust(-d, -d, 2 * d, 2 * d);
+            foreach(Page* page, _pages) {
+                  QRectF r(refresh.translated(-page->pos()));
+                  if (r.intersects(page->bbox()))
+                        page->updatePositions(r);
+                  }
             foreach(MuseScoreView* v, viewer)
                   v->dataChanged(refresh);
             }
@@ -204,6 +216,7 @@ void Score::endUndoRedo()
                   score->setUndoRedo(false);
                   score->setUpdateAll(true);
                   }
+            score->invalidateEventCache();
             score->setPlaylistDirty(true);
             }
       end();
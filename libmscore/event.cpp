@@ -320,6 +320,91 @@ void Event::setTuning(qreal v)       { d->_tuning = v;                 }
 bool Event::operator==(const Event& e) const { return d->operator==(*e.d);   }
 void Event::dump() const             { d->dump(); }
 
+//---------------------------------------------------------
+//   add
+//    append the events of el moved by tickOffset
+//---------------------------------------------------------
+
+void EventMap::add(const EventMap& el, int tickOffset)
+      {
+      reserve(size() + el.size());
+      for (const_iterator i = el.constBegin(); i != el.constEnd(); ++i)
+            append(TimedEvent(i->tick + tickOffset, i->event));
+      }
+
+//---------------------------------------------------------
+//   sort
+//    stable sort by tick; events are mostly added in
+//    order, so check that first
+//---------------------------------------------------------
+
+static bool tickLessThan(const TimedEvent& e1, const TimedEvent& e2)
+      {
+      return e1.tick < e2.tick;
+      }
+
+void EventMap::sort()
+      {
+      const TimedEvent* e = constData();
+      int n               = size();
+      for (int i = 1; i < n; ++i) {
+            if (e[i].tick < e[i-1].tick) {
+                  qStableSort(begin(), end(), tickLessThan);
+                  break;
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   merge
+//    merge the sorted map el into this sorted map; on the
+//    same tick our events come first
+//---------------------------------------------------------
+
+void EventMap::merge(const EventMap& el)
+      {
+      if (el.isEmpty())
+            return;
+      if (isEmpty() || el.front().tick >= back().tick) {
+            *this += el;
+            return;
+            }
+      EventMap l;
+      l.reserve(size() + el.size());
+      const_iterator i1 = constBegin();
+      const_iterator i2 = el.constBegin();
+      while (i1 != constEnd() && i2 != el.constEnd()) {
+            if (i2->tick < i1->tick)
+                  l.append(*i2++);
+            else
+                  l.append(*i1++);
+            }
+      for (; i1 != constEnd(); ++i1)
+            l.append(*i1);
+      for (; i2 != el.constEnd(); ++i2)
+            l.append(*i2);
+      *this = l;
+      }
+
+//---------------------------------------------------------
+//   find
+//    first event at or after tick
+//---------------------------------------------------------
+
+EventMap::const_iterator EventMap::find(int tick) const
+      {
+      int lo = 0;
+      int hi = size();
+      while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (at(mid).tick < tick)
+                  lo = mid + 1;
+            else
+                  hi = mid;
+            }
+      return constBegin() + lo;
+      }
+
 //---------------------------------------------------------
 //    midi_meta_name
 //---------------------------------------------------------
@@ -200,7 +200,35 @@ class EventList : public QList<Event> {
       void insertNote(int channel, Note*);
       };
 
-class EventMap : public QMap<int, Event> {};
+//---------------------------------------------------------
+//   TimedEvent
+//---------------------------------------------------------
+
+struct TimedEvent {
+      int tick;
+      Event event;
+      TimedEvent() {}
+      TimedEvent(int t, const Event& e) : tick(t), event(e) {}
+      };
+
+Q_DECLARE_TYPEINFO(TimedEvent, Q_MOVABLE_TYPE);
+
+//---------------------------------------------------------
+//   EventMap
+//    events in one contiguous array, sorted by tick;
+//    events with the same tick keep the order in which
+//    they were added. Fill with add() and call sort()
+//    once, sorted maps are combined with merge().
+//---------------------------------------------------------
+
+class EventMap : public QVector<TimedEvent> {
+   public:
+      void add(int tick, const Event& e) { append(TimedEvent(tick, e)); }
+      void add(const EventMap&, int tickOffset);
+      void sort();
+      void merge(const EventMap&);
+      const_iterator find(int tick) const;
+      };
 
 typedef EventList::iterator iEvent;
 typedef EventList::const_iterator ciEvent;
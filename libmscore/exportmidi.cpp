@@ -267,20 +267,20 @@ bool ExportMidi::write(const QString& name, bool midiExpandRepeats)
             EventMap events;
             cs->renderPart(&events, part);
 
-            for (EventMap::const_iterator i = events.begin(); i != events.end(); ++i) {
-                  Event event = i.value();
+            for (EventMap::const_iterator i = events.constBegin(); i != events.constEnd(); ++i) {
+                  const Event& event = i->event;
                   if (event.channel() != channel)
                         continue;
                   if (event.type() == ME_NOTEON) {
                         Event ne(ME_NOTEON);
-                        ne.setOntime(i.key());
+                        ne.setOntime(i->tick);
                         ne.setChannel(event.channel());
                         ne.setPitch(event.pitch());
                         ne.setVelo(event.velo());
                         track->insert(ne);
                         }
                   else if (event.type() == ME_CONTROLLER) {
-                        track->addCtrl(i.key(), event.channel(), event.controller(), event.value());
+                        track->addCtrl(i->tick, event.channel(), event.controller(), event.value());
                         }
                   else {
                         qDebug("writeMidi: unknown midi event 0x%02x\n", event.type());
@@ -15,34 +15,47 @@
 
 //---------------------------------------------------------
 //   clear
+//    only valid while neither reader nor writer are active
 //---------------------------------------------------------
 
 void FifoBase::clear()
 	{
-	ridx    = 0;
-      widx    = 0;
-      counter = 0;
+	ridx.fetchAndStoreRelease(0);
+      widx.fetchAndStoreRelease(0);
+      _dropped.fetchAndStoreRelease(0);
+      }
+
+//---------------------------------------------------------
+//   count
+//    objects in fifo
+//---------------------------------------------------------
+
+int FifoBase::count() const
+      {
+      int w = widx.fetchAndAddAcquire(0);
+      int r = ridx.fetchAndAddAcquire(0);
+      return (w - r + 2 * maxCount) % (2 * maxCount);
       }
 
 //---------------------------------------------------------
 //   push
+//    called by the writer after the object at writeSlot()
+//    is written
 //---------------------------------------------------------
 
 void FifoBase::push()
       {
-      widx = (widx + 1) % maxCount;
-//      q_atomic_increment(&counter);
-      ++counter;
+      widx.fetchAndStoreRelease((int(widx) + 1) % (2 * maxCount));
       }
 
 //---------------------------------------------------------
 //   pop
+//    called by the reader after the object at readSlot()
+//    is read
 //---------------------------------------------------------
 
 void FifoBase::pop()
       {
-      ridx = (ridx + 1) % maxCount;
-      // q_atomic_decrement(&counter);
-      --counter;
+      ridx.fetchAndStoreRelease((int(ridx) + 1) % (2 * maxCount));
       }
 
@@ -16,32 +16,40 @@
 
 //---------------------------------------------------------
 //   FifoBase
+//    lock free ring buffer
 //    - works only for one reader/writer
-//    - reader writes ridx
-//    - writer writes widx
-//    - reader decrements counter
-//    - writer increments counter
-//    - counter increment/decrement must be atomic
+//    - reader writes ridx, writer writes widx
+//    - indices run modulo 2 * maxCount, so a full fifo
+//      (widx - ridx == maxCount) can be told from an
+//      empty one (widx == ridx) without a shared counter
+//    - the writer publishes an object with a release store
+//      of widx, the reader frees a slot with a release
+//      store of ridx; both load the other index with
+//      acquire semantics
 //---------------------------------------------------------
 
 class FifoBase {
+      mutable QAtomicInt ridx;      // read index
+      mutable QAtomicInt widx;      // write index
+      QAtomicInt _dropped;          // objects lost on overflow
 
    protected:
-      int ridx;               // read index
-      int widx;               // write index
-      volatile int counter;   // objects in fifo
       int maxCount;
 
+      int writeSlot() const   { return int(widx) % maxCount; }
+      int readSlot() const    { return int(ridx) % maxCount; }
       void push();
       void pop();
+      void drop()             { _dropped.fetchAndAddRelaxed(1); }
 
    public:
-      FifoBase()              { clear(); }
+      FifoBase()              { maxCount = 1; clear(); }
       virtual ~FifoBase()     {}
       void clear();
-      int count() const       { return counter; }
-      bool isEmpty() const    { return counter == 0; }
-      bool isFull() const     { return maxCount == counter; }
+      int count() const;
+      bool isEmpty() const    { return count() == 0; }
+      bool isFull() const     { return count() == maxCount; }
+      int dropped() const     { return int(_dropped); }
       };
 
 #endif
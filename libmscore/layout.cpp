@@ -48,12 +48,14 @@
 
 //---------------------------------------------------------
 //   rebuildBspTree
+//    the trees are updated lazily on the next query; only
+//    elements which moved are reinserted
 //---------------------------------------------------------
 
 void Score::rebuildBspTree()
       {
       foreach(Page* page, _pages)
-            page->rebuildBspTree();
+            page->updateBspTree();
       }
 
 //---------------------------------------------------------
@@ -346,9 +348,14 @@ void Score::layoutChords1(Segment* segment, int staffIdx)
 
 void Score::layoutStage1()
       {
-      int idx = 0;
-      for (Measure* m = firstMeasure(); m; m = m->nextMeasure()) {
-            ++idx;
+      layoutStage1(firstMeasure(), lastMeasure());
+      }
+
+void Score::layoutStage1(Measure* fm, Measure* lm)
+      {
+      if (fm == 0)
+            return;
+      for (Measure* m = fm; m; m = m->nextMeasure()) {
             m->layoutStage1();
             foreach(Spanner* spanner, m->spannerFor()) {
                   if (spanner->type() == VOLTA)
@@ -364,6 +371,8 @@ void Score::layoutStage1()
                               m->setBreakMMRest(true);
                         }
                   }
+            if (m == lm)
+                  break;
             }
       }
 
@@ -374,187 +383,200 @@ void Score::layoutStage1()
 
 void Score::layoutStage2()
       {
-      int tracks = nstaves() * VOICES;
+      layoutStage2(firstMeasure(), lastMeasure());
+      }
 
-      for (int track = 0; track < tracks; ++track) {
-            ChordRest* a1    = 0;      // start of (potential) beam
-            Beam* beam       = 0;      // current beam
-            Measure* measure = 0;
+void Score::layoutStage2(Measure* fm, Measure* lm)
+      {
+      if (fm == 0)
+            return;
+      layoutTracks(&Score::autoBeam, fm, lm->nextMeasure());
+      }
 
-            BeamMode bm = BEAM_AUTO;
-            SegmentTypes st = SegGrace | SegChordRest;
-            for (Segment* segment = firstSegment(st); segment; segment = segment->next1(st)) {
-                  ChordRest* cr = static_cast<ChordRest*>(segment->element(track));
-                  if (cr == 0)
-                        continue;
-                  bm = cr->beamMode();
-                  if (cr->measure() != measure) {
-                        if (measure && !beamModeMid(bm)) {
-                              if (beam) {
-                                    beam->layout1();
-                                    beam = 0;
-                                    }
-                              else if (a1) {
-                                    a1->removeDeleteBeam();
-                                    a1->layoutStem1();
-                                    a1 = 0;
-                                    }
-                              }
-                        measure = cr->measure();
-                        if (!beamModeMid(bm)) {
-                              a1      = 0;
-                              beam    = 0;
-                              }
-                        }
-                  if (segment->subtype() == SegGrace) {
-                        Segment* nseg = segment->next();
-                        if (nseg
-                           && nseg->subtype() == SegGrace
-                           && nseg->element(track)
-                           && cr->durationType().hooks()
-                           && static_cast<ChordRest*>(nseg->element(track))->durationType().hooks())
-                              {
-                              Beam* b = cr->beam();
-                              if (b == 0 || b->elements().front() != cr) {
-                                    b = new Beam(this);
-                                    b->setTrack(track);
-                                    b->setGenerated(true);
-                                    cr->removeDeleteBeam();
-                                    b->add(cr);
-                                    }
-                              Segment* s = nseg;
-                              for (;;) {
-                                    nseg = s;
-                                    ChordRest* cr = static_cast<ChordRest*>(nseg->element(track));
-                                    if (!cr->durationType().hooks())
-                                          break;
-                                    b->add(cr);
-                                    s = nseg->next();
-                                    if (!s || (s->subtype() != SegGrace) || !s->element(track)
-                                       || !static_cast<ChordRest*>(s->element(track))->durationType().hooks())
-                                          break;
-                                    }
-                              if (b->elements().size() < 2) {
-                                    b->elements().front()->removeDeleteBeam();
-                                    }
-                              else
-                                    b->layout1();
-                              segment = nseg;
-                              }
-                        else {
-                              cr->removeDeleteBeam();
-                              cr->layoutStem1();
-                              }
-                        continue;
-                        }
-                  if ((cr->durationType().type() <= TDuration::V_QUARTER) || (bm == BEAM_NO)) {
+//---------------------------------------------------------
+//   autoBeam
+//    auto - beamer for one track
+//---------------------------------------------------------
+
+void Score::autoBeam(int track, Measure* fm, Measure* em)
+      {
+      ChordRest* a1    = 0;      // start of (potential) beam
+      Beam* beam       = 0;      // current beam
+      Measure* measure = 0;
+
+      BeamMode bm = BEAM_AUTO;
+      SegmentTypes st = SegGrace | SegChordRest;
+      for (Segment* segment = fm->first(st); segment && segment->measure() != em; segment = segment->next1(st)) {
+            ChordRest* cr = static_cast<ChordRest*>(segment->element(track));
+            if (cr == 0)
+                  continue;
+            bm = cr->beamMode();
+            if (cr->measure() != measure) {
+                  if (measure && !beamModeMid(bm)) {
                         if (beam) {
                               beam->layout1();
                               beam = 0;
                               }
-                        if (a1) {
+                        else if (a1) {
                               a1->removeDeleteBeam();
                               a1->layoutStem1();
                               a1 = 0;
                               }
+                        }
+                  measure = cr->measure();
+                  if (!beamModeMid(bm)) {
+                        a1      = 0;
+                        beam    = 0;
+                        }
+                  }
+            if (segment->subtype() == SegGrace) {
+                  Segment* nseg = segment->next();
+                  if (nseg
+                     && nseg->subtype() == SegGrace
+                     && nseg->element(track)
+                     && cr->durationType().hooks()
+                     && static_cast<ChordRest*>(nseg->element(track))->durationType().hooks())
+                        {
+                        Beam* b = cr->beam();
+                        if (b == 0 || b->elements().front() != cr) {
+                              b = new Beam(this);
+                              b->setTrack(track);
+                              b->setGenerated(true);
+                              cr->removeDeleteBeam();
+                              b->add(cr);
+                              }
+                        Segment* s = nseg;
+                        for (;;) {
+                              nseg = s;
+                              ChordRest* cr = static_cast<ChordRest*>(nseg->element(track));
+                              if (!cr->durationType().hooks())
+                                    break;
+                              b->add(cr);
+                              s = nseg->next();
+                              if (!s || (s->subtype() != SegGrace) || !s->element(track)
+                                 || !static_cast<ChordRest*>(s->element(track))->durationType().hooks())
+                                    break;
+                              }
+                        if (b->elements().size() < 2) {
+                              b->elements().front()->removeDeleteBeam();
+                              }
+                        else
+                              b->layout1();
+                        segment = nseg;
+                        }
+                  else {
                         cr->removeDeleteBeam();
                         cr->layoutStem1();
-                        continue;
                         }
-                  bool beamEnd = false;
+                  continue;
+                  }
+            if ((cr->durationType().type() <= TDuration::V_QUARTER) || (bm == BEAM_NO)) {
                   if (beam) {
-                        ChordRest* le = beam->elements().back();
-                        if ((!beamModeMid(bm) && (le->tuplet() != cr->tuplet())) || (bm == BEAM_BEGIN)) {
+                        beam->layout1();
+                        beam = 0;
+                        }
+                  if (a1) {
+                        a1->removeDeleteBeam();
+                        a1->layoutStem1();
+                        a1 = 0;
+                        }
+                  cr->removeDeleteBeam();
+                  cr->layoutStem1();
+                  continue;
+                  }
+            bool beamEnd = false;
+            if (beam) {
+                  ChordRest* le = beam->elements().back();
+                  if ((!beamModeMid(bm) && (le->tuplet() != cr->tuplet())) || (bm == BEAM_BEGIN)) {
+                        beamEnd = true;
+                        }
+                  else if (!beamModeMid(bm)) {
+                        if (endBeam(measure->timesig(), cr, le))
                               beamEnd = true;
-                              }
-                        else if (!beamModeMid(bm)) {
-                              if (endBeam(measure->timesig(), cr, le))
-                                    beamEnd = true;
-                              if (le->tick() + le->actualTicks() < cr->tick())
-                                    beamEnd = true;
-                              }
-                        if (beamEnd) {
+                        if (le->tick() + le->actualTicks() < cr->tick())
+                              beamEnd = true;
+                        }
+                  if (beamEnd) {
+                        beam->layout1();
+                        beam = 0;
+                        }
+                  else {
+                        cr->removeDeleteBeam();
+                        beam->add(cr);
+                        cr = 0;
+
+                        // is cr the last beam element?
+                        if (bm == BEAM_END) {
                               beam->layout1();
                               beam = 0;
                               }
-                        else {
-                              cr->removeDeleteBeam();
-                              beam->add(cr);
-                              cr = 0;
-
-                              // is cr the last beam element?
-                              if (bm == BEAM_END) {
-                                    beam->layout1();
-                                    beam = 0;
-                                    }
+                        }
+                  }
+            if (cr && cr->tuplet() && (cr->tuplet()->elements().back() == cr)) {
+                  if (beam) {
+                        beam->layout1();
+                        beam = 0;
+                        cr->removeDeleteBeam();
+                        cr->layoutStem1();
+                        }
+                  else if (a1) {
+                        beam = a1->beam();
+                        if (beam == 0 || beam->elements().front() != a1) {
+                              beam = new Beam(this);
+                              beam->setTrack(track);
+                              beam->setGenerated(true);
+                              a1->removeDeleteBeam();
+                              beam->add(a1);
                               }
+                        cr->removeDeleteBeam();
+                        beam->add(cr);
+                        a1 = 0;
+                        beam->layout1();
+                        beam = 0;
                         }
-                  if (cr && cr->tuplet() && (cr->tuplet()->elements().back() == cr)) {
-                        if (beam) {
-                              beam->layout1();
-                              beam = 0;
-                              cr->removeDeleteBeam();
-                              cr->layoutStem1();
+                  else {
+                        //cr->setBeam(0);
+                        cr->removeDeleteBeam();
+                        cr->layoutStem1();
+                        }
+                  }
+            else if (cr) {
+                  if (a1 == 0)
+                        a1 = cr;
+                  else {
+                        if (!beamModeMid(bm)
+                             &&
+                             (endBeam(measure->timesig(), cr, a1)
+                             || bm == BEAM_BEGIN
+                             || (a1->segment()->subtype() != cr->segment()->subtype())
+                             || (a1->tick() + a1->actualTicks() < cr->tick())
+                             )
+                           ) {
+                              a1->removeDeleteBeam();
+                              a1->layoutStem1();      //?
+                              a1 = cr;
                               }
-                        else if (a1) {
+                        else {
                               beam = a1->beam();
                               if (beam == 0 || beam->elements().front() != a1) {
                                     beam = new Beam(this);
-                                    beam->setTrack(track);
                                     beam->setGenerated(true);
+                                    beam->setTrack(track);
                                     a1->removeDeleteBeam();
                                     beam->add(a1);
                                     }
                               cr->removeDeleteBeam();
                               beam->add(cr);
                               a1 = 0;
-                              beam->layout1();
-                              beam = 0;
-                              }
-                        else {
-                              //cr->setBeam(0);
-                              cr->removeDeleteBeam();
-                              cr->layoutStem1();
-                              }
-                        }
-                  else if (cr) {
-                        if (a1 == 0)
-                              a1 = cr;
-                        else {
-                              if (!beamModeMid(bm)
-                                   &&
-                                   (endBeam(measure->timesig(), cr, a1)
-                                   || bm == BEAM_BEGIN
-                                   || (a1->segment()->subtype() != cr->segment()->subtype())
-                                   || (a1->tick() + a1->actualTicks() < cr->tick())
-                                   )
-                                 ) {
-                                    a1->removeDeleteBeam();
-                                    a1->layoutStem1();      //?
-                                    a1 = cr;
-                                    }
-                              else {
-                                    beam = a1->beam();
-                                    if (beam == 0 || beam->elements().front() != a1) {
-                                          beam = new Beam(this);
-                                          beam->setGenerated(true);
-                                          beam->setTrack(track);
-                                          a1->removeDeleteBeam();
-                                          beam->add(a1);
-                                          }
-                                    cr->removeDeleteBeam();
-                                    beam->add(cr);
-                                    a1 = 0;
-                                    }
                               }
                         }
                   }
-            if (beam)
-                  beam->layout1();
-            else if (a1) {
-                  a1->removeDeleteBeam();
-                  a1->layoutStem1();
-                  }
+            }
+      if (beam)
+            beam->layout1();
+      else if (a1) {
+            a1->removeDeleteBeam();
+            a1->layoutStem1();
             }
       }
 
@@ -564,12 +586,174 @@ void Score::layoutStage2()
 
 void Score::layoutStage3()
       {
+      layoutStage3(firstMeasure(), lastMeasure());
+      }
+
+//---------------------------------------------------------
+//   runJobs
+//    run fn for all jobs on the thread pool; with
+//    MScore::parallelLayout switched off the jobs are run
+//    in order in the calling thread
+//---------------------------------------------------------
+
+template <class T> static void runJobs(QVector<T>& jobs, void (*fn)(T&))
+      {
+      if (MScore::parallelLayout)
+            QtConcurrent::blockingMap(jobs, fn);
+      else {
+            for (int i = 0; i < jobs.size(); ++i)
+                  fn(jobs[i]);
+            }
+      }
+
+//---------------------------------------------------------
+//   layoutChordsJob
+//    layoutChords1() only touches the chords of one segment;
+//    all staves of a segment are done in one job as they
+//    share the dot position list of the segment
+//---------------------------------------------------------
+
+static void layoutChordsJob(Segment*& segment)
+      {
+      Score* score = segment->score();
+      int n        = score->nstaves();
+      for (int staffIdx = 0; staffIdx < n; ++staffIdx)
+            score->layoutChords1(segment, staffIdx);
+      }
+
+void Score::layoutStage3(Measure* fm, Measure* lm)
+      {
+      if (fm == 0)
+            return;
       SegmentTypes st = SegChordRest | SegGrace;
-      for (int staffIdx = 0; staffIdx < nstaves(); ++staffIdx) {
-            for (Segment* segment = firstSegment(st); segment; segment = segment->next1(st)) {
-                  layoutChords1(segment, staffIdx);
-                  }
+      Measure* em     = lm->nextMeasure();
+      QVector<Segment*> sl;
+      for (Segment* segment = fm->first(st); segment && segment->measure() != em; segment = segment->next1(st))
+            sl.append(segment);
+      runJobs(sl, layoutChordsJob);
+      }
+
+//---------------------------------------------------------
+//   PartJob
+//    all tracks of one part of a layout stage
+//---------------------------------------------------------
+
+struct PartJob {
+      Score* score;
+      void (Score::*stage)(int, Measure*, Measure*);
+      int strack;
+      int etrack;
+      Measure* fm;
+      Measure* em;
+      bool serial;
+      QList<UndoCommand*> undoList;
+      };
+
+static void layoutPart(PartJob& job)
+      {
+      UndoCollector collector(&job.undoList);
+      for (int track = job.strack; track < job.etrack; ++track)
+            (job.score->*job.stage)(track, job.fm, job.em);
+      }
+
+static void runPartJob(PartJob& job)
+      {
+      if (!job.serial)
+            layoutPart(job);
+      }
+
+//---------------------------------------------------------
+//   layoutTracks
+//    Run stage for all tracks of measures fm up to em, one
+//    job per part on the thread pool. Cross staff chords
+//    stay inside their part, so the parts are independent
+//    in these stages; the tracks of a part are done in
+//    track order as in a serial layout.
+//    The parts in serial are laid out afterwards in this
+//    thread.
+//    The only shared state the jobs change is the undo
+//    stack (Chord::layoutStem1() adds and removes hooks);
+//    those commands are collected per part and appended in
+//    part order.
+//---------------------------------------------------------
+
+void Score::layoutTracks(void (Score::*stage)(int, Measure*, Measure*), Measure* fm, Measure* em,
+   const QSet<Part*>& serial)
+      {
+      int n = _parts.size();
+      QVector<PartJob> jobs(n);
+      for (int i = 0; i < n; ++i) {
+            Part* part   = _parts[i];
+            PartJob& job = jobs[i];
+            job.score    = this;
+            job.stage    = stage;
+            job.strack   = staffIdx(part) * VOICES;
+            job.etrack   = job.strack + part->nstaves() * VOICES;
+            job.fm       = fm;
+            job.em       = em;
+            job.serial   = serial.contains(part);
+            }
+      runJobs(jobs, runPartJob);
+      for (int i = 0; i < n; ++i) {
+            if (jobs[i].serial)
+                  layoutPart(jobs[i]);
+            }
+      for (int i = 0; i < n; ++i)
+            undo()->append(jobs[i].undoList);
+      }
+
+//---------------------------------------------------------
+//   MinWidthJob
+//---------------------------------------------------------
+
+struct MinWidthJob {
+      Measure* measure;
+      QList<UndoCommand*> undoList;
+      };
+
+static void runMinWidthJob(MinWidthJob& job)
+      {
+      UndoCollector collector(&job.undoList);
+      job.measure->minWidth1();
+      }
+
+static void runMinWidthJobs(Score* score, QVector<MinWidthJob>& jobs)
+      {
+      if (jobs.isEmpty())
+            return;
+      runJobs(jobs, runMinWidthJob);
+      for (int i = 0; i < jobs.size(); ++i)
+            score->undo()->append(jobs[i].undoList);
+      }
+
+//---------------------------------------------------------
+//   computeMinWidths
+//    Compute the minimum width of all dirty measures from
+//    fm up to lm on the thread pool before line breaking
+//    asks for them. Measures are independent here.
+//    Measures which are not yet part of an up to date
+//    system are left to planSystemBreaks() and
+//    layoutSystem(): lyrics layout needs the system.
+//    The end barlines are created first as layoutSystem()
+//    does before asking for the width.
+//---------------------------------------------------------
+
+void Score::computeMinWidths(Measure* fm, Measure* lm)
+      {
+      if (fm == 0 || undoRedo())
+            return;
+      Measure* em = lm ? lm->nextMeasure() : 0;
+      QVector<MinWidthJob> jobs;
+      for (Measure* m = fm; m && m != em; m = m->nextMeasure()) {
+            System* system = m->system();
+            if (m->minWidthValid() || system == 0 || system->staves()->size() != nstaves())
+                  continue;
+            m->createEndBarLines();
+            MinWidthJob job;
+            job.measure = m;
+            jobs.append(job);
             }
+      runMinWidthJobs(this, jobs);
       }
 
 //---------------------------------------------------------
@@ -652,50 +836,111 @@ void Score::doLayout()
             layoutPages();    // create list of pages
             }
 
-      //---------------------------------------------------
-      //   place Spanner & beams
-      //---------------------------------------------------
+      layoutSpanner(firstMeasure(), lastMeasure());
+
+      rebuildBspTree();
+
+      }     // unlock mutex
+      foreach(MuseScoreView* v, viewer)
+            v->layoutChanged();
+      }
+
+//---------------------------------------------------------
+//   serialBeamParts
+//    Beam::layout2() calls back into the score: distributed
+//    beams respace() the segments of all staves and cross
+//    staff or user modified beams relayout the chords of
+//    other voices and staves with layoutChords1().
+//    Return the parts with such beams or moved chords in
+//    measures fm up to em; a distributed beam makes all
+//    parts serial.
+//---------------------------------------------------------
 
-      int tracks = nstaves * VOICES;
-      for (int track = 0; track < tracks; ++track) {
-            for (Segment* segment = firstSegment(); segment; segment = segment->next1()) {
+static QSet<Part*> serialBeamParts(Score* score, Measure* fm, Measure* em)
+      {
+      QSet<Part*> parts;
+      int tracks = score->nstaves() * VOICES;
+      for (Segment* segment = fm->first(); segment && segment->measure() != em; segment = segment->next1()) {
+            for (int track = 0; track < tracks; ++track) {
                   Element* e = segment->element(track);
-                  if (e && e->isChordRest()) {
-                        ChordRest* cr = static_cast<ChordRest*>(e);
-                        if (cr->beam() && cr->beam()->elements().front() == cr)
-                              cr->beam()->layout();
-
-                        if (cr->type() == CHORD) {
-                              Chord* c = static_cast<Chord*>(cr);
-                              if (!c->beam())
-                                    c->layoutStem();
-                              c->layoutArpeggio2();
-                              foreach(Note* n, c->notes()) {
-                                    Tie* tie = n->tieFor();
-                                    if (tie)
-                                          tie->layout();
-                                    }
-                              }
-                        cr->layoutArticulations();
-                        }
-                  else if (e && e->type() == BAR_LINE)
-                        e->layout();
-                  if (track == tracks-1) {
-                        foreach(Spanner* s, segment->spannerFor())
-                              s->layout();
-                        foreach(Element* e, segment->annotations())
-                              e->layout();
+                  if (e == 0 || !e->isChordRest())
+                        continue;
+                  ChordRest* cr = static_cast<ChordRest*>(e);
+                  Beam* beam    = cr->beam();
+                  Part* part    = score->staff(track / VOICES)->part();
+                  if (beam && beam->distribute())
+                        return score->parts().toSet();
+                  if (cr->staffMove() || (beam && beam->userModified()))
+                        parts.insert(part);
+                  }
+            }
+      return parts;
+      }
+
+//---------------------------------------------------------
+//   layoutSpanner
+//    place spanner & beams of measures fm - lm
+//---------------------------------------------------------
+
+void Score::layoutSpanner(Measure* fm, Measure* lm)
+      {
+      if (fm == 0)
+            return;
+      Measure* em = lm->nextMeasure();
+      layoutTracks(&Score::layoutBeams, fm, em, serialBeamParts(this, fm, em));
+
+      // ties, spanner and annotations add their segments to
+      // systems, they are laid out serially
+      int tracks = nstaves() * VOICES;
+      for (Segment* segment = fm->first(); segment && segment->measure() != em; segment = segment->next1()) {
+            for (int track = 0; track < tracks; ++track) {
+                  Element* e = segment->element(track);
+                  if (e == 0 || e->type() != CHORD)
+                        continue;
+                  foreach(Note* n, static_cast<Chord*>(e)->notes()) {
+                        Tie* tie = n->tieFor();
+                        if (tie)
+                              tie->layout();
                         }
                   }
+            foreach(Spanner* s, segment->spannerFor())
+                  s->layout();
+            foreach(Element* e, segment->annotations())
+                  e->layout();
             }
-      for (Measure* m = firstMeasure(); m; m = m->nextMeasure())
+      for (Measure* m = fm; m; m = m->nextMeasure()) {
             m->layout2();
+            if (m == lm)
+                  break;
+            }
+      }
 
-      rebuildBspTree();
+//---------------------------------------------------------
+//   layoutBeams
+//    place beams, stems, articulations and bar lines of
+//    one track
+//---------------------------------------------------------
 
-      }     // unlock mutex
-      foreach(MuseScoreView* v, viewer)
-            v->layoutChanged();
+void Score::layoutBeams(int track, Measure* fm, Measure* em)
+      {
+      for (Segment* segment = fm->first(); segment && segment->measure() != em; segment = segment->next1()) {
+            Element* e = segment->element(track);
+            if (e && e->isChordRest()) {
+                  ChordRest* cr = static_cast<ChordRest*>(e);
+                  if (cr->beam() && cr->beam()->elements().front() == cr)
+                        cr->beam()->layout();
+
+                  if (cr->type() == CHORD) {
+                        Chord* c = static_cast<Chord*>(cr);
+                        if (!c->beam())
+                              c->layoutStem();
+                        c->layoutArpeggio2();
+                        }
+                  cr->layoutArticulations();
+                  }
+            else if (e && e->type() == BAR_LINE)
+                  e->layout();
+            }
       }
 
 //---------------------------------------------------------
@@ -872,6 +1117,156 @@ Measure* Score::skipEmptyMeasures(Measure* m, System* system)
       return m;
       }
 
+//---------------------------------------------------------
+//   measureWidth
+//    minimum width of measure m in a system; isFirstMeasure
+//    includes the system header
+//---------------------------------------------------------
+
+qreal Score::measureWidth(Measure* m, bool isFirstMeasure)
+      {
+      qreal ww = isFirstMeasure ? m->minWidth2() : m->minWidth1();
+
+      // add width for EndBarLine
+      Segment* seg = m->last();
+      if (seg->subtype() == SegEndBarLine) {
+            BarLine* bl = static_cast<BarLine*>(seg->element(0));
+            if (m->repeatFlags() & RepeatEnd) {
+                  if (bl && (bl->subtype() != END_REPEAT)) {
+                        ww += spatium();   // HACK
+                        }
+                  }
+            }
+// printf("%d) %d %f\n", m->no()+1, m->systemHeader(), m->minWidth());
+
+      ww *= m->userStretch() * styleD(ST_measureSpacing);
+      qreal minMeasureWidth = point(styleS(ST_minMeasureWidth));
+      if (ww < minMeasureWidth)
+            ww = minMeasureWidth;
+      return ww;
+      }
+
+//---------------------------------------------------------
+//   systemDemerits
+//    cost of a system with measures of width w stretched
+//    to width; a ragged system is not stretched
+//---------------------------------------------------------
+
+static qreal systemDemerits(qreal w, qreal width, bool ragged)
+      {
+      if (w > width)
+            return 1.0e10;          // overfull, only a single measure
+      if (ragged)
+            return 1.0;
+      qreal r = (width - w) / w;    // stretch ratio
+      qreal b = 100.0 * r * r * r;
+      return (1.0 + b) * (1.0 + b);
+      }
+
+//---------------------------------------------------------
+//   planSystemBreaks
+//    Used if ST_planSystemBreaks is set, otherwise
+//    layoutSystem() fills systems one by one.
+//    Choose the system breaks from fm up to the next line
+//    or page break by minimizing the demerits of all
+//    systems (Knuth/Plass) instead of filling systems one
+//    by one. margin is the left margin of the system and
+//    width the space available for measures.
+//    The row starts are remembered in _rowStarts and
+//    followed by layoutSystem(); if a system turns out
+//    not to fit, layoutSystem() breaks early and the rest
+//    is planned again from there.
+//    Measures without a cached minimum width (as after
+//    loading) get it computed here, so the breaks do not
+//    depend on the layout history. If the section contains
+//    a horizontal frame nothing is planned and systems are
+//    filled greedily.
+//    Like layoutSystemRow() the last system of the score
+//    is left ragged if it fills no more than
+//    ST_lastSystemFillLimit of the row; all other systems
+//    are stretched.
+//---------------------------------------------------------
+
+void Score::planSystemBreaks(Measure* fm, qreal margin, qreal width)
+      {
+      _rowStarts.clear();
+      if (_layoutMode != LayoutPage || styleI(ST_FixMeasureNumbers) || styleB(ST_createMultiMeasureRests))
+            return;
+
+      QVector<Measure*> ml;
+      for (MeasureBase* mb = fm; mb; mb = mb->next()) {
+            ElementType t = mb->type();
+            if (t == VBOX || t == TBOX || t == FBOX)
+                  break;
+            if (t != MEASURE)
+                  return;
+            Measure* m = static_cast<Measure*>(mb);
+            ml.append(m);
+            if (m->lineBreak() || m->pageBreak())
+                  break;
+            }
+      int n = ml.size();
+      if (n < 2)
+            return;
+
+      //
+      // compute missing widths with the measures placed in
+      // the system of fm; only their horizontal layout
+      // matters for the width
+      //
+      System* system = fm->system();
+      QVector<MinWidthJob> jobs;
+      QVector<System*> oldSystems;
+      for (int i = 1; i < n; ++i) {
+            Measure* m = ml[i];
+            if (m->minWidthValid())
+                  continue;
+            oldSystems.append(m->system());
+            m->setSystem(system);
+            m->createEndBarLines();
+            MinWidthJob job;
+            job.measure = m;
+            jobs.append(job);
+            }
+      runMinWidthJobs(this, jobs);
+      for (int i = 0; i < jobs.size(); ++i)
+            jobs[i].measure->setSystem(oldSystems[i]);
+
+      qreal header = measureWidth(fm, true) - measureWidth(fm, false);
+      QVector<qreal> wl(n);
+      for (int i = 0; i < n; ++i)
+            wl[i] = measureWidth(ml[i], false);
+      bool lastSystem = ml.back()->next() == 0;
+      qreal fillLimit = styleD(ST_lastSystemFillLimit);
+
+      //
+      // demerits[j] is the minimal cost of setting the first
+      // j measures; prev[j] is the first measure of the last
+      // system in that solution
+      //
+      QVector<qreal> demerits(n + 1);
+      QVector<int> prev(n + 1);
+      demerits[0] = 0.0;
+      for (int j = 1; j <= n; ++j) {
+            qreal w     = header;
+            demerits[j] = -1.0;
+            prev[j]     = j - 1;
+            for (int i = j - 1; i >= 0; --i) {
+                  w += wl[i];
+                  if (w > width && i < j - 1)
+                        break;
+                  bool ragged = lastSystem && j == n && (margin + w) / (margin + width) <= fillLimit;
+                  qreal d     = demerits[i] + systemDemerits(w, width, ragged);
+                  if (demerits[j] < 0.0 || d < demerits[j]) {
+                        demerits[j] = d;
+                        prev[j]     = i;
+                        }
+                  }
+            }
+      for (int j = n; j > 0; j = prev[j])
+            _rowStarts.insert(ml[prev[j]]);
+      }
+
 //---------------------------------------------------------
 //   layoutSystem
 //    return true if line continues
@@ -941,23 +1336,9 @@ bool Score::layoutSystem(qreal& minWidth, qreal w, bool isFirstSystem, bool long
                         }
 
                   m->createEndBarLines();       // TODO: type not set right here
-                  ww = isFirstMeasure ? m->minWidth2() : m->minWidth1();
-
-                  // add width for EndBarLine
-                  Segment* seg = m->last();
-                  if (seg->subtype() == SegEndBarLine) {
-                        BarLine* bl = static_cast<BarLine*>(seg->element(0));
-                        if (m->repeatFlags() & RepeatEnd) {
-                              if (bl && (bl->subtype() != END_REPEAT)) {
-                                    ww += spatium();   // HACK
-                                    }
-                              }
-                        }
-// printf("%d) %d %f\n", m->no()+1, m->systemHeader(), m->minWidth());
-
-                  ww *= m->userStretch() * styleD(ST_measureSpacing);
-                  if (ww < minMeasureWidth)
-                        ww = minMeasureWidth;
+                  if (isFirstMeasure && styleB(ST_planSystemBreaks) && !_rowStarts.contains(m))
+                        planSystemBreaks(m, minWidth, systemWidth - minWidth);
+                  ww = measureWidth(m, isFirstMeasure);
                   isFirstMeasure = false;
                   }
 
@@ -987,7 +1368,8 @@ bool Score::layoutSystem(qreal& minWidth, qreal w, bool isFirstSystem, bool long
                         break;
                   }
             if ((n && system->measures().size() >= n)
-               || continueFlag || pbreak || (nt == VBOX || nt == TBOX || nt == FBOX)) {
+               || continueFlag || pbreak || (nt == VBOX || nt == TBOX || nt == FBOX)
+               || (nextMeasure && _rowStarts.contains(nextMeasure))) {
                   system->setPageBreak(curMeasure->pageBreak());
                   curMeasure = nextMeasure;
                   break;
@@ -1239,121 +1621,210 @@ void Score::remove(Element* el)
 
 //---------------------------------------------------------
 //   reLayout
+//    extend the range of modified measures
 //---------------------------------------------------------
 
 void Score::reLayout(Measure* m)
       {
-      startLayout = m;
+      if (m == 0)
+            return;
+      if (startLayout == 0 || m->tick() < startLayout->tick())
+            startLayout = m;
+      if (endLayout == 0 || m->tick() > endLayout->tick())
+            endLayout = m;
+      }
+
+//---------------------------------------------------------
+//   rowStart
+//    return index of the first system in the row
+//    containing system idx
+//---------------------------------------------------------
+
+static int rowStart(const QList<System*>& sl, int idx)
+      {
+      while (idx > 0 && sl[idx]->sameLine())
+            --idx;
+      return idx;
       }
 
 //---------------------------------------------------------
 //   doReLayout
+//    relayout the measures startLayout - endLayout and
+//    the systems containing them; stop as soon as the
+//    system breaks converge with the previous layout
+//
 //    return true, if relayout was successful; if false
-//    a full layout must be done starting at "startLayout"
+//    a full layout must be done
 //---------------------------------------------------------
 
 bool Score::doReLayout()
       {
-#if 0
-#if 0
-      if (startLayout->type() == MEASURE)
-            static_cast<Measure*>(startLayout)->layout0();
-#endif
-      System* system  = startLayout->system();
-      qreal sysWidth  = system->width();
-      qreal minWidth = system->leftMargin();
-
-      //
-      //  check if measures still fit in system
-      //
-      MeasureBase* m = 0;
-      foreach(m, system->measures()) {
-            qreal ww;
-            if (m->type() == HBOX)
-                  ww = point(static_cast<Box*>(m)->boxWidth());
-            else {            // MEASURE
-                  Measure* measure = static_cast<Measure*>(m);
-//TODOXX                  measure->layout0();
-//TODO            measure->layoutBeams1();
-
-                  measure->layoutX(1.0, true);
-                  ww      = measure->layoutWidth();
-                  qreal stretch = measure->userStretch() * styleD(ST_measureSpacing);
-
-                  ww *= stretch;
-                  if (ww < point(styleS(ST_minMeasureWidth)))
-                        ww = point(styleS(ST_minMeasureWidth));
-                  }
-            minWidth += ww;
+      if (startLayout == 0 || endLayout == 0 || layoutFlags || _layoutMode == LayoutLine)
+            return false;
+      foreach(Staff* st, _staves) {
+            if (st->updateKeymap())
+                  return false;
             }
-      if (minWidth > sysWidth)            // measure does not fit: do full layout
+      int sysIdx = _systems.indexOf(startLayout->system());
+      int endIdx = _systems.indexOf(endLayout->system());
+      if (sysIdx == -1 || endIdx == -1 || _pages.isEmpty())
             return false;
 
+      {
+      QWriteLocker locker(&_layoutLock);
+
       //
-      // check if another measure will fit into system
+      // start one row early: modified measures may now fit
+      // into the previous system
       //
-      m = m->next();
-      if (m && m->type() == MEASURE) {
-            Measure* measure = static_cast<Measure*>(m);
-            measure->layoutX(1.0, true);
-            qreal ww      = measure->layoutWidth();
-            qreal stretch = measure->userStretch() * styleD(ST_measureSpacing);
-
-            ww *= stretch;
-            if (ww < point(styleS(ST_minMeasureWidth)))
-                  ww = point(styleS(ST_minMeasureWidth));
-            if ((minWidth + ww) <= sysWidth)    // if another measure fits, do full layout
+      sysIdx = rowStart(_systems, sysIdx);
+      if (sysIdx > 0)
+            sysIdx = rowStart(_systems, sysIdx - 1);
+      while (endIdx + 1 < _systems.size() && _systems[endIdx + 1]->sameLine())
+            ++endIdx;
+
+      Measure* fm = _systems[sysIdx]->firstMeasure();
+      Measure* lm = _systems[endIdx]->lastMeasure();
+      if (fm == 0 || lm == 0)
+            return false;
+
+      // beams must not cross the boundaries of the range
+      for (int track = 0; track < ntracks(); ++track) {
+            Segment* s = fm->first(SegGrace | SegChordRest);
+            ChordRest* cr = s ? static_cast<ChordRest*>(s->element(track)) : 0;
+            if (cr && (beamModeMid(cr->beamMode()) || (cr->beam() && cr->beam()->elements().front() != cr)))
+                  return false;
+            Measure* nm = lm->nextMeasure();
+            s  = nm ? nm->first(SegGrace | SegChordRest) : 0;
+            cr = s ? static_cast<ChordRest*>(s->element(track)) : 0;
+            if (cr && (beamModeMid(cr->beamMode()) || (cr->beam() && cr->beam()->elements().front() != cr)))
                   return false;
             }
+
+      for (MeasureBase* mb = _systems[sysIdx]->measures().front(); mb; mb = mb->next()) {
+            mb->layout0();
+            if (mb == lm)
+                  break;
+            }
+      layoutStage1(fm, lm);
+      layoutStage2(fm, lm);
+      layoutStage3(fm, lm);
+      computeMinWidths(fm, lm);
+      _rowStarts.clear();
+
       //
-      // stretch measures
+      // derive first system state from the previous row
       //
-      minWidth    = system->leftMargin();
-      qreal totalWeight = 0.0;
-      foreach (MeasureBase* mb, system->measures()) {
-            if (mb->type() == HBOX)
-                  minWidth += point(static_cast<Box*>(mb)->boxWidth());
-            else {
-                  Measure* m   = static_cast<Measure*>(mb);
-                  minWidth    += m->layoutWidth();
-                  totalWeight += m->ticks() * m->userStretch();
-                  }
+      bool firstSystem        = true;
+      bool startWithLongNames = true;
+      for (int i = sysIdx - 1; i >= 0; --i) {
+            if (_systems[i]->isVbox())
+                  continue;
+            Measure* m = _systems[i]->lastMeasure();
+            firstSystem = m && m->sectionBreak() && _layoutMode != LayoutFloat;
+            startWithLongNames = firstSystem && m->sectionBreak()->startWithLongNames();
+            break;
             }
 
-      qreal rest = (sysWidth - minWidth) / totalWeight;
+      //
+      // relayout rows until the first measure of a row is
+      // past the modified range and starts a row of the
+      // previous layout
+      //
+      QList<System*> tail = _systems.mid(sysIdx);
+      QList<QList<System*> > oldPages;
+      QList<QList<QPointF> > oldPos;
+      QList<QRectF> oldRects;
+      foreach(Page* page, _pages) {
+            oldPages.append(*page->systems());
+            oldRects.append(page->canvasBoundingRect());
+            QList<QPointF> pl;
+            foreach(System* s, *page->systems())
+                  pl.append(s->pos());
+            oldPos.append(pl);
+            }
+      while (_systems.size() > sysIdx)
+            _systems.takeLast();
+      curSystem  = sysIdx;
+      curMeasure = tail.front()->measures().front();
+      qreal w    = pageFormat()->printableWidth() * MScore::DPI;
+      int etick  = endLayout->endTick();
 
-      bool firstMeasure = true;
-      QPointF pos;
-      foreach(MeasureBase* mb, system->measures()) {
-            qreal ww = 0.0;
-            if (mb->type() == MEASURE) {
-                  if (firstMeasure) {
-                        pos.rx() += system->leftMargin();
-                        firstMeasure = false;
-                        }
-                  mb->setPos(pos);
-                  Measure* m    = static_cast<Measure*>(mb);
-                  qreal weight = m->ticks() * m->userStretch();
-                  ww            = m->layoutWidth() + rest * weight;
-                  m->layout(ww);
+      while (curMeasure) {
+            // old systems inside the modified range or before
+            // curMeasure are reused by getNextSystem()
+            while (!tail.isEmpty()) {
+                  const QList<MeasureBase*>& ml = tail.front()->measures();
+                  MeasureBase* mb = ml.isEmpty() ? 0 : ml.front();
+                  if (mb && mb->tick() >= etick && mb->tick() >= curMeasure->tick())
+                        break;
+                  _systems.append(tail.takeFirst());
                   }
-            else if (mb->type() == HBOX) {
-                  mb->setPos(pos);
-                  ww = point(static_cast<Box*>(mb)->boxWidth());
-                  mb->layout();
+            if (curSystem > sysIdx && !tail.isEmpty()
+               && tail.front()->measures().front() == curMeasure
+               && !tail.front()->sameLine())
+                  break;            // system breaks converged
+            layoutNextRow(w, firstSystem, startWithLongNames);
+            }
+      QList<System*> relayouted = _systems.mid(sysIdx, curSystem - sysIdx);
+      while (_systems.size() > curSystem)
+            _systems.takeLast();
+      if (curMeasure)
+            _systems.append(tail);
+
+      lm = relayouted.back()->lastMeasure();
+      layoutPages();
+      layoutSpanner(fm, lm);
+
+      // spanner and ties ending in the relayouted range
+      Measure* em = lm->nextMeasure();
+      for (Segment* s = fm->first(); s && s->measure() != em; s = s->next1()) {
+            foreach(Spanner* sp, s->spannerBack()) {
+                  Element* se = sp->startElement();
+                  if (se && se->type() == SEGMENT && static_cast<Segment*>(se)->tick() < fm->tick())
+                        sp->layout();
+                  }
+            if (s->measure() != fm || !(s->isChordRest() || s->isGrace()))
+                  continue;
+            for (int track = 0; track < ntracks(); ++track) {
+                  Element* e = s->element(track);
+                  if (e == 0 || e->type() != CHORD)
+                        continue;
+                  foreach(Note* n, static_cast<Chord*>(e)->notes()) {
+                        if (n->tieBack())
+                              n->tieBack()->layout();
+                        }
                   }
-            pos.rx() += ww;
             }
 
-      foreach(MeasureBase* mb, system->measures()) {
-            if (mb->type() == MEASURE)
-                  static_cast<Measure*>(mb)->layout2();
+      //
+      // only pages with changed content need a bsp tree update
+      //
+      int n = _pages.size();
+      for (int i = 0; i < n; ++i) {
+            Page* page = _pages[i];
+            bool changed = i >= oldPages.size() || oldPages[i] != *page->systems();
+            for (int k = 0; !changed && k < page->systems()->size(); ++k) {
+                  System* s = page->systems()->at(k);
+                  changed = relayouted.contains(s) || (oldPos[i][k] != s->pos());
+                  }
+            if (changed) {
+                  // ties and slurs may cross into the neighbour pages
+                  for (int k = qMax(i - 1, 0); k <= qMin(i + 1, n - 1); ++k) {
+                        _pages[k]->updateBspTree();
+                        addRefresh(_pages[k]->canvasBoundingRect());
+                        }
+                  if (i < oldRects.size())
+                        addRefresh(oldRects[i]);
+                  }
             }
+      for (int i = n; i < oldRects.size(); ++i)
+            addRefresh(oldRects[i]);
+      }     // unlock mutex
 
-      rebuildBspTree();
+      foreach(MuseScoreView* v, viewer)
+            v->layoutChanged();
       return true;
-#endif
-      return false;
       }
 
 //---------------------------------------------------------
@@ -1771,44 +2242,56 @@ void Score::layoutSystems()
 
       qreal w  = pageFormat()->printableWidth() * MScore::DPI;
 
-      while (curMeasure) {
-            ElementType t = curMeasure->type();
-            if (t == VBOX || t == TBOX || t == FBOX) {
-                  System* system = getNextSystem(false, true);
-                  foreach(SysStaff* ss, *system->staves())
-                        delete ss;
-                  system->staves()->clear();
-                  system->setWidth(w);
-                  VBox* vbox = static_cast<VBox*>(curMeasure);
-                  vbox->setParent(system);
-                  vbox->layout();
-                  system->setHeight(vbox->height());
-                  system->rxpos() = 0.0;
-                  system->setPageBreak(vbox->pageBreak());
-                  system->measures().push_back(vbox);
-                  curMeasure = curMeasure->next();
-                  ++curSystem;
-                  }
-            else {
-                  QList<System*> sl  = layoutSystemRow(w, firstSystem, startWithLongNames);
-                  for (int i = 0; i < sl.size(); ++i)
-                        sl[i]->setSameLine(i != 0);
-                  firstSystem = false;
-                  startWithLongNames = false;
-                  if (!sl.isEmpty()) {
-                        Measure* lm = sl.back()->lastMeasure();
-                        firstSystem = lm && lm->sectionBreak() && _layoutMode != LayoutFloat;
-                        startWithLongNames = firstSystem && lm->sectionBreak()->startWithLongNames();
-                        }
-                  else
-                        qDebug("empty system!\n");
-                  }
-            }
+      computeMinWidths(firstMeasure(), lastMeasure());
+      _rowStarts.clear();
+      while (curMeasure)
+            layoutNextRow(w, firstSystem, startWithLongNames);
       // TODO: make undoable:
       while (_systems.size() > curSystem)
             _systems.takeLast();
       }
 
+//---------------------------------------------------------
+//   layoutNextRow
+//    layout the next row of systems starting at
+//    curMeasure; a frame makes up a row of its own
+//---------------------------------------------------------
+
+void Score::layoutNextRow(qreal w, bool& firstSystem, bool& startWithLongNames)
+      {
+      ElementType t = curMeasure->type();
+      if (t == VBOX || t == TBOX || t == FBOX) {
+            System* system = getNextSystem(false, true);
+            foreach(SysStaff* ss, *system->staves())
+                  delete ss;
+            system->staves()->clear();
+            system->setWidth(w);
+            VBox* vbox = static_cast<VBox*>(curMeasure);
+            vbox->setParent(system);
+            vbox->layout();
+            system->setHeight(vbox->height());
+            system->rxpos() = 0.0;
+            system->setPageBreak(vbox->pageBreak());
+            system->measures().push_back(vbox);
+            curMeasure = curMeasure->next();
+            ++curSystem;
+            }
+      else {
+            QList<System*> sl  = layoutSystemRow(w, firstSystem, startWithLongNames);
+            for (int i = 0; i < sl.size(); ++i)
+                  sl[i]->setSameLine(i != 0);
+            firstSystem = false;
+            startWithLongNames = false;
+            if (!sl.isEmpty()) {
+                  Measure* lm = sl.back()->lastMeasure();
+                  firstSystem = lm && lm->sectionBreak() && _layoutMode != LayoutFloat;
+                  startWithLongNames = firstSystem && lm->sectionBreak()->startWithLongNames();
+                  }
+            else
+                  qDebug("empty system!\n");
+            }
+      }
+
 //---------------------------------------------------------
 //   layoutLinear
 //---------------------------------------------------------
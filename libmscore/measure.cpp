@@ -648,7 +648,7 @@ ChordRest* Measure::findChordRest(int tick, int track)
 
 Segment* Measure::tick2segment(int tick, bool grace) const
       {
-      for (Segment* s = first(); s; s = s->next()) {
+      for (Segment* s = _segments.lowerBound(tick); s; s = s->next()) {
             if (s->tick() == tick) {
                   if (grace && (s->subtype() == SegGrace))
                         return s;
@@ -671,13 +671,9 @@ Segment* Measure::tick2segment(int tick, bool grace) const
 
 Segment* Measure::findSegment(SegmentType st, int t)
       {
-      Segment* s;
-      for (s = first(); s && s->tick() < t; s = s->next())
-            ;
-
-      for (Segment* ss = s; ss && ss->tick() == t; ss = ss->next()) {
-            if (ss->subtype() == st)
-                  return ss;
+      for (Segment* s = _segments.lowerBound(t); s && s->tick() == t; s = s->next()) {
+            if (s->subtype() == st)
+                  return s;
             }
       return 0;
       }
@@ -766,8 +762,7 @@ Segment* Measure::getSegment(SegmentType st, int t, int gl)
       Segment* s;
 
       // find the first segment at tick >= t
-      for (s = first(); s && s->tick() < t; s = s->next())
-            ;
+      s = _segments.lowerBound(t);
 
       // find the first SegChordRest segment at tick = t
       // while counting the SegGrace segments
@@ -896,8 +891,7 @@ void Measure::add(Element* el)
                   else {
                         Segment* s;
                         if (st == SegGrace) {
-                              for (s = first(); s && s->tick() < t; s = s->next())
-                                    ;
+                              s = _segments.lowerBound(t);
                               if (s && (s->tick() > t)) {
                                     seg->setParent(this);
                                     _segments.insert(seg, s);
@@ -910,8 +904,7 @@ void Measure::add(Element* el)
                                     }
                               }
                         else {
-                              for (s = first(); s && s->tick() < t; s = s->next())
-                                    ;
+                              s = _segments.lowerBound(t);
                               if (s) {
                                     if (st == SegChordRest) {
                                           while (s && s->subtype() != st && s->tick() == t) {
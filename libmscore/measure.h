@@ -22,6 +22,7 @@
 #include "measurebase.h"
 #include "fraction.h"
 #include "segmentlist.h"
+#include "event.h"
 
 class Xml;
 class Beam;
@@ -130,6 +131,8 @@ class Measure : public MeasureBase {
 
       QColor _endBarLineColor;
 
+      QHash<const Part*, EventMap> _events;  ///< cached playback events per part, see Score::renderPart()
+
       void push_back(Segment* e);
       void push_front(Segment* e);
 
@@ -177,12 +180,18 @@ class Measure : public MeasureBase {
       qreal minWidth() const;
       qreal minWidth1() const;
       qreal minWidth2() const;
+      bool minWidthValid() const           { return _minWidth1 != 0.0; }
       void setMinWidth1(qreal w)           { _minWidth1 = w;      }
       void setMinWidth2(qreal w)           { _minWidth2 = w;      }
       bool systemHeader() const            { return _systemHeader; }
       void setSystemHeader(bool val)       { _systemHeader = val;  }
       void setDirty();
 
+      bool hasEvents(const Part* p) const  { return _events.contains(p); }
+      EventMap& events(const Part* p)      { return _events[p]; }
+      void clearEvents()                   { _events.clear();   }
+      void clearEvents(const Part* p)      { _events.remove(p); }
+
       Fraction timesig() const             { return _timesig;     }
       void setTimesig(const Fraction& f)   { _timesig = f;        }
       Fraction len() const                 { return _len;         }
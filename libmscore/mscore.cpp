@@ -43,6 +43,7 @@ QString MScore::partStyle;
 QString MScore::soundFont;
 QString MScore::lastError;
 bool    MScore::layoutDebug = false;
+bool    MScore::parallelLayout = true;
 int     MScore::division    = 480;
 int     MScore::sampleRate  = 44100;
 int     MScore::mtcType;
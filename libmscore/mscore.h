@@ -715,6 +715,7 @@ class MScore : public QObject {
       static QString soundFont;
       static QString lastError;
       static bool layoutDebug;
+      static bool parallelLayout;   // run layout stages on the thread pool
 
       static int division;
       static int sampleRate;
@@ -129,6 +129,7 @@ Page::Page(Score* s)
    _no(0)
       {
       bspTreeValid = false;
+      bspTreeDirty = false;
       }
 
 Page::~Page()
@@ -142,8 +143,7 @@ Page::~Page()
 QList<const Element*> Page::items(const QRectF& r)
       {
 #ifdef USE_BSP
-      if (!bspTreeValid)
-            doRebuildBspTree();
+      validateBspTree();
       return bspTree.items(r);
 #else
       return QList<const Element*>();
@@ -153,14 +153,48 @@ QList<const Element*> Page::items(const QRectF& r)
 QList<const Element*> Page::items(const QPointF& p)
       {
 #ifdef USE_BSP
-      if (!bspTreeValid)
-            doRebuildBspTree();
+      validateBspTree();
       return bspTree.items(p);
 #else
       return QList<const Element*>();
 #endif
       }
 
+//---------------------------------------------------------
+//   drawItems
+//    elements in r sorted by stacking order, together with
+//    their page positions
+//---------------------------------------------------------
+
+QVector<BspItem> Page::drawItems(const QRectF& r)
+      {
+#ifdef USE_BSP
+      validateBspTree();
+      return bspTree.drawItems(r);
+#else
+      return QVector<BspItem>();
+#endif
+      }
+
+//---------------------------------------------------------
+//   updatePositions
+//    elements in r may have moved without a new layout
+//    (dragging, editing); refresh their cached positions.
+//    After a layout the tree may still hold elements the
+//    layout deleted; they are dropped by validateBspTree(),
+//    which also reinserts moved elements.
+//---------------------------------------------------------
+
+void Page::updatePositions(const QRectF& r)
+      {
+#ifdef USE_BSP
+      if (!bspTreeValid || bspTreeDirty)
+            validateBspTree();
+      else
+            bspTree.updatePositions(r);
+#endif
+      }
+
 //---------------------------------------------------------
 //   appendSystem
 //---------------------------------------------------------
@@ -671,25 +705,101 @@ void PageFormat::writeMusicXML(Xml& xml, qreal conversion) const
 void Page::doRebuildBspTree()
       {
       QList<Element*> el;
+      collectBspElements(&el);
+      // insert in stacking order, this keeps the leaves sorted cheaply
+      qStableSort(el.begin(), el.end(), elementLessThan);
+
+      int n = el.size();
+      bspTree.initialize(bspRect(), n);
+      for (int i = 0; i < n; ++i)
+            bspTree.insert(el.at(i));
+      bspTreeValid = true;
+      bspTreeDirty = false;
+      }
+
+//---------------------------------------------------------
+//   collectBspElements
+//---------------------------------------------------------
+
+void Page::collectBspElements(QList<Element*>* el)
+      {
       foreach(System* s, _systems) {
             foreach(MeasureBase* m, s->measures()) {
-                  m->scanElements(&el, collectElements, false);
+                  m->scanElements(el, collectElements, false);
                   }
             }
-      scanElements(&el, collectElements, false);
+      scanElements(el, collectElements, false);
+      }
 
-      int n = el.size();
+//---------------------------------------------------------
+//   bspRect
+//---------------------------------------------------------
+
+QRectF Page::bspRect() const
+      {
       if (score()->layoutMode() == LayoutLine) {
             qreal h = _systems.front()->height();
             MeasureBase* mb = _systems.front()->measures().back();
             qreal w = mb->x() + mb->width();
-            bspTree.initialize(QRectF(0.0, 0.0, w, h), n);
+            return QRectF(0.0, 0.0, w, h);
             }
-      else
-            bspTree.initialize(abbox(), n);
-      for (int i = 0; i < n; ++i)
-            bspTree.insert(el.at(i));
-      bspTreeValid = true;
+      return abbox();
+      }
+
+//---------------------------------------------------------
+//   doUpdateBspTree
+//    Only elements which are new, gone, moved or changed
+//    since the last update are removed from or inserted
+//    into the tree. An element is identified by its address
+//    together with its type and stacking order, as layout
+//    may delete an element and allocate another one at the
+//    same address. If the page geometry or the number of
+//    elements changed too much, the tree is built from
+//    scratch.
+//---------------------------------------------------------
+
+void Page::doUpdateBspTree()
+      {
+      QList<Element*> el;
+      collectBspElements(&el);
+      int n = el.size();
+      int o = bspTree.count();
+      if (bspRect() != bspTree.bounds() || n > o * 2 || n < o / 2) {
+            doRebuildBspTree();
+            return;
+            }
+
+      QSet<const Element*> current;
+      QList<Element*> il;
+      foreach(Element* e, el) {
+            current.insert(e);
+            if (!bspTree.contains(e))
+                  il.append(e);
+            else if (bspTree.changed(e)) {
+                  bspTree.remove(e);
+                  il.append(e);
+                  }
+            }
+      foreach(const Element* e, bspTree.elements()) {
+            if (!current.contains(e))
+                  bspTree.remove(e);
+            }
+      qStableSort(il.begin(), il.end(), elementLessThan);
+      foreach(Element* e, il)
+            bspTree.insert(e);
+      bspTreeDirty = false;
+      }
+
+//---------------------------------------------------------
+//   validateBspTree
+//---------------------------------------------------------
+
+void Page::validateBspTree()
+      {
+      if (!bspTreeValid)
+            doRebuildBspTree();
+      else if (bspTreeDirty)
+            doUpdateBspTree();
       }
 #endif
 
@@ -127,9 +127,14 @@ class Page : public Element {
       int _no;                      // page number
 #ifdef USE_BSP
       BspTree bspTree;
+      void collectBspElements(QList<Element*>*);
+      QRectF bspRect() const;
       void doRebuildBspTree();
+      void doUpdateBspTree();
+      void validateBspTree();
 #endif
-      bool bspTreeValid;
+      bool bspTreeValid;            ///< false: rebuild the bsp tree from scratch
+      bool bspTreeDirty;            ///< elements may have changed: update incrementally
 
       QString replaceTextMacros(const QString&) const;
       void drawStyledHeaderFooter(QPainter*, int area, const QPointF&, const QString&) const;
@@ -161,7 +166,10 @@ class Page : public Element {
 
       QList<const Element*> items(const QRectF& r);
       QList<const Element*> items(const QPointF& p);
+      QVector<BspItem> drawItems(const QRectF& r);
+      void updatePositions(const QRectF& r);
       void rebuildBspTree()   { bspTreeValid = false; }
+      void updateBspTree()    { bspTreeDirty = true;  }
       QPointF pagePos() const { return QPointF(); }     ///< position in page coordinates
       QList<System*> searchSystem(const QPointF& pos) const;
       Measure* searchMeasure(const QPointF& p) const;
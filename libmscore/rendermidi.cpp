@@ -113,9 +113,9 @@ static void playNote(EventMap* events, const Note* note, int channel, int pitch,
       ev.setVelo(velo);
       ev.setTuning(note->tuning());
       ev.setNote(note);
-      events->insertMulti(onTime, ev);
+      events->add(onTime, ev);
       ev.setVelo(0);
-      events->insertMulti(offTime, ev);
+      events->add(offTime, ev);
       }
 
 //---------------------------------------------------------
@@ -175,7 +175,7 @@ static void collectNote(EventMap* events, int channel, const Note* note, int vel
                         ev.setController(CTRL_PITCH);
                         int midiPitch = (pitch * 16384) / 300;
                         ev.setValue(midiPitch);
-                        events->insertMulti(tick, ev);
+                        events->add(tick, ev);
                         }
                   if (pitch != points[pt+1].pitch) {
                         int pitchDelta = points[pt+1].pitch - pitch;
@@ -191,7 +191,7 @@ static void collectNote(EventMap* events, int channel, const Note* note, int vel
 
                               int midiPitch = (p * 16384) / 1200;
                               ev.setValue(midiPitch);
-                              events->insertMulti(tick + tick3, ev);
+                              events->add(tick + tick3, ev);
                               }
                         tick1 = tick2;
                         }
@@ -202,7 +202,7 @@ static void collectNote(EventMap* events, int channel, const Note* note, int vel
             ev.setChannel(channel);
             ev.setController(CTRL_PITCH);
             ev.setValue(0);
-            events->insertMulti(tick + ticks, ev);
+            events->add(tick + ticks, ev);
             }
 #endif
       }
@@ -242,6 +242,88 @@ static void collectMeasureEvents(EventMap* events, Measure* m, Part* part, int t
       int strack      = firstStaffIdx * VOICES;
       int etrack      = nextStaffIdx * VOICES;
 
+      //
+      // collect program changes and controller first, they
+      // are sent before the notes on the same tick
+      //
+      for (Segment* s = m->first(SegChordRest); s; s = s->next(SegChordRest)) {
+            // int tick = s->tick();
+            foreach(Element* e, s->annotations()) {
+                  if (e->type() != STAFF_TEXT
+                     || e->staffIdx() < firstStaffIdx
+                     || e->staffIdx() >= nextStaffIdx)
+                        continue;
+                  const StaffText* st = static_cast<const StaffText*>(e);
+                  int tick = s->tick() + tickOffset;
+
+                  Instrument* instr = e->staff()->part()->instr(tick);
+                  foreach (const ChannelActions& ca, *st->channelActions()) {
+                        int channel = ca.channel;
+                        foreach(const QString& ma, ca.midiActionNames) {
+                              NamedEventList* nel = instr->midiAction(ma, channel);
+                              if (!nel)
+                                    continue;
+                              int n = nel->events.size();
+                              for (int i = 0; i < n; ++i) {
+                                    Event event(nel->events[i]);
+                                    event.setOntime(tick);
+                                    event.setChannel(channel);
+                                    events->add(tick, event);
+                                    }
+                              }
+                        }
+                  if (st->setAeolusStops()) {
+                        Staff* staff = st->staff();
+                        int voice   = 0;
+                        int channel = staff->channel(tick, voice);
+
+                        for (int i = 0; i < 4; ++i) {
+                              Event event(ME_CONTROLLER);
+                              event.setController(98);
+                              event.setValue(64 + i);
+                              event.setOntime(tick);
+                              event.setChannel(channel);
+                              events->add(tick, event);
+
+                              event.setValue(96 + i);
+                              events->add(tick, event);
+
+                              for (int k = 15; k >= 0; --k) {
+                                    if (st->getAeolusStop(i, k)) {
+                                          Event stop(ME_CONTROLLER);
+                                          stop.setController(98);
+                                          stop.setValue(k);
+                                          stop.setOntime(tick);
+                                          stop.setChannel(channel);
+                                          events->add(tick, stop);
+                                          }
+                                    }
+                              }
+                        }
+                  }
+            foreach(Spanner* e, s->spannerFor()) {
+                  if (e->staffIdx() < firstStaffIdx || e->staffIdx() >= nextStaffIdx)
+                        continue;
+                  if (e->type() == PEDAL) {
+                        Segment* s1 = static_cast<Segment*>(e->startElement());
+                        Segment* s2 = static_cast<Segment*>(e->endElement());
+                        Staff* staff = e->staff();
+
+                        int channel = staff->channel(s1->tick(), 0);
+
+                        Event event(ME_CONTROLLER);
+                        event.setChannel(channel);
+                        event.setController(CTRL_SUSTAIN);
+
+                        event.setValue(127);
+                        events->add(s1->tick() + tickOffset, event);
+
+                        event.setValue(0);
+                        events->add(s2->tick() + tickOffset - 1, event);
+                        }
+                  }
+            }
+
       for (Segment* seg = m->first(st); seg; seg = seg->next(st)) {
             int tick = seg->tick();
             for (int track = strack; track < etrack; ++track) {
@@ -316,95 +398,134 @@ static void collectMeasureEvents(EventMap* events, Measure* m, Part* part, int t
                         }
                   }
             }
+      }
 
-      //
-      // collect program changes and controller
-      //
-      for (Segment* s = m->first(SegChordRest); s; s = s->next(SegChordRest)) {
-            // int tick = s->tick();
-            foreach(Element* e, s->annotations()) {
-                  if (e->type() != STAFF_TEXT
-                     || e->staffIdx() < firstStaffIdx
-                     || e->staffIdx() >= nextStaffIdx)
-                        continue;
-                  const StaffText* st = static_cast<const StaffText*>(e);
-                  int tick = s->tick() + tickOffset;
+//---------------------------------------------------------
+//   eventContext
+//    everything outside of a measure the events of a
+//    part depend on: velocities, channels, ottava shifts
+//    and instruments
+//---------------------------------------------------------
 
-                  Instrument* instr = e->staff()->part()->instr(tick);
-                  foreach (const ChannelActions& ca, *st->channelActions()) {
-                        int channel = ca.channel;
-                        foreach(const QString& ma, ca.midiActionNames) {
-                              NamedEventList* nel = instr->midiAction(ma, channel);
-                              if (!nel)
-                                    continue;
-                              int n = nel->events.size();
-                              for (int i = n-1; i >= 0; --i) {
-                                    Event event(nel->events[i]);
-                                    event.setOntime(tick);
-                                    event.setChannel(channel);
-                                    events->insertMulti(tick, event);
-                                    }
-                              }
+static QVector<int> eventContext(Part* part)
+      {
+      QVector<int> c;
+      foreach(Staff* staff, *part->staves()) {
+            c.append(staff->primaryStaff());
+            const VeloList& vl = staff->velocities();
+            c.append(vl.size());
+            for (VeloList::const_iterator i = vl.constBegin(); i != vl.constEnd(); ++i) {
+                  c.append(i.key());
+                  c.append(i.value().type);
+                  c.append(i.value().val);
+                  }
+            for (int voice = 0; voice < VOICES; ++voice) {
+                  const QMap<int,int>* cl = staff->channelList(voice);
+                  c.append(cl->size());
+                  for (QMap<int,int>::const_iterator i = cl->constBegin(); i != cl->constEnd(); ++i) {
+                        c.append(i.key());
+                        c.append(i.value());
                         }
-                  if (st->setAeolusStops()) {
-                        Staff* staff = st->staff();
-                        int voice   = 0;
-                        int channel = staff->channel(tick, voice);
+                  }
+            const PitchList& pl = staff->pitchOffsets();
+            c.append(pl.size());
+            for (PitchList::const_iterator i = pl.constBegin(); i != pl.constEnd(); ++i) {
+                  c.append(i.key());
+                  c.append(i.value());
+                  }
+            }
+      InstrumentList* il = part->instrList();
+      for (InstrumentList::const_iterator i = il->begin(); i != il->end(); ++i) {
+            c.append(i->first);
+            foreach(const Channel& a, i->second.channel()) {
+                  c.append(a.channel);
+                  foreach(const MidiArticulation& ma, a.articulation) {
+                        c.append(qHash(ma.name));
+                        c.append(ma.velocity);
+                        c.append(ma.gateTime);
+                        }
+                  }
+            }
+      return c;
+      }
 
-                        for (int i = 0; i < 4; ++i) {
-                              for (int k = 0; k < 16; ++k) {
-                                    if (st->getAeolusStop(i, k)) {
-                                          Event event;
-                                          event.setType(ME_CONTROLLER);
-                                          event.setController(98);
-                                          event.setValue(k);
-                                          event.setOntime(tick);
-                                          event.setChannel(channel);
-                                          events->insertMulti(tick, event);
-                                          }
-                                    }
-                              Event event(ME_CONTROLLER);
-                              event.setController(98);
-                              event.setValue(96 + i);
-                              event.setOntime(tick);
-                              event.setChannel(channel);
-                              events->insertMulti(tick, event);
+//---------------------------------------------------------
+//   tiedForward
+//    true if a note of measure m is tied into the
+//    following measure
+//---------------------------------------------------------
 
-                              event.setValue(64 + i);
-                              events->insertMulti(tick, event);
-                              }
+static bool tiedForward(Measure* m)
+      {
+      for (Segment* s = m->first(SegChordRest); s; s = s->next(SegChordRest)) {
+            foreach(Element* e, s->elist()) {
+                  if (e == 0 || e->type() != CHORD)
+                        continue;
+                  foreach(Note* note, static_cast<Chord*>(e)->notes()) {
+                        Tie* tie = note->tieFor();
+                        if (tie && tie->endNote() && tie->endNote()->chord()->measure() != m)
+                              return true;
                         }
                   }
-            foreach(Spanner* e, s->spannerFor()) {
-                  if (e->staffIdx() < firstStaffIdx || e->staffIdx() >= nextStaffIdx)
-                        continue;
-                  if (e->type() == PEDAL) {
-                        Segment* s1 = static_cast<Segment*>(e->startElement());
-                        Segment* s2 = static_cast<Segment*>(e->endElement());
-                        Staff* staff = e->staff();
+            }
+      return false;
+      }
 
-                        int channel = staff->channel(s1->tick(), 0);
+//---------------------------------------------------------
+//   invalidateEventCache
+//    drop the cached events of measures fm - lm; a tie
+//    into the range changes the length of notes in
+//    front of it
+//---------------------------------------------------------
 
-                        Event event(ME_CONTROLLER);
-                        event.setChannel(channel);
-                        event.setController(CTRL_SUSTAIN);
+void Score::invalidateEventCache(Measure* fm, Measure* lm)
+      {
+      if (fm == 0) {
+            for (Measure* m = firstMeasure(); m; m = m->nextMeasure())
+                  m->clearEvents();
+            return;
+            }
+      Measure* em = lm ? lm->nextMeasure() : 0;
+      for (Measure* m = fm; m && m != em; m = m->nextMeasure())
+            m->clearEvents();
+      for (Measure* m = fm->prevMeasure(); m && tiedForward(m); m = m->prevMeasure())
+            m->clearEvents();
+      }
 
-                        event.setValue(127);
-                        events->insertMulti(s1->tick() + tickOffset, event);
+//---------------------------------------------------------
+//   measureEvents
+//    return the events of part in measure m rendered
+//    without tick offset; they are cached in the measure
+//---------------------------------------------------------
 
-                        event.setValue(0);
-                        events->insertMulti(s2->tick() + tickOffset - 1, event);
-                        }
-                  }
+static const EventMap& measureEvents(Measure* m, Part* part)
+      {
+      if (!m->hasEvents(part)) {
+            EventMap& el = m->events(part);
+            collectMeasureEvents(&el, m, part, 0);
+            el.sort();
             }
+      return m->events(part);
       }
 
 //---------------------------------------------------------
 //   renderPart
+//    The events of every measure are rendered once and
+//    cached; unwinding repeats only moves the cached
+//    events. Edits drop the cache of the touched measures
+//    (invalidateEventCache()), a changed context drops
+//    the cache of the part.
 //---------------------------------------------------------
 
 void Score::renderPart(EventMap* events, Part* part)
       {
+      QVector<int> context = eventContext(part);
+      if (context != _eventContext.value(part)) {
+            for (Measure* m = firstMeasure(); m; m = m->nextMeasure())
+                  m->clearEvents(part);
+            _eventContext[part] = context;
+            }
+
       Measure* lastMeasure = 0;
       foreach (const RepeatSegment* rs, *repeatList()) {
             int startTick  = rs->tick;
@@ -413,16 +534,18 @@ void Score::renderPart(EventMap* events, Part* part)
             for (Measure* m = tick2measure(startTick); m; m = m->nextMeasure()) {
                   if (lastMeasure && m->isRepeatMeasure(part)) {
                         int offset = m->tick() - lastMeasure->tick();
-                        collectMeasureEvents(events, lastMeasure, part, tickOffset + offset);
+                        events->add(measureEvents(lastMeasure, part), tickOffset + offset);
                         }
                   else {
                         lastMeasure = m;
-                        collectMeasureEvents(events, m, part, tickOffset);
+                        events->add(measureEvents(m, part), tickOffset);
                         }
                   if (m->tick() + m->ticks() >= endTick)
                         break;
                   }
             }
+      // notes of a measure may end in the next one
+      events->sort();
       }
 
 //---------------------------------------------------------
@@ -464,10 +587,14 @@ void Score::toEList(EventMap* events)
       _foundPlayPosAfterRepeats = false;
       updateChannel();
       updateVelo();
-      foreach (Part* part, _parts)
-            renderPart(events, part);
+      foreach (Part* part, _parts) {
+            EventMap el;
+            renderPart(&el, part);
+            events->merge(el);
+            }
 
       // add metronome ticks
+      EventMap ticks;
       foreach (const RepeatSegment* rs, *repeatList()) {
             int startTick  = rs->tick;
             int endTick    = startTick + rs->len;
@@ -491,12 +618,13 @@ void Score::toEList(EventMap* events)
                         int tick = m->tick() + i * tw + tickOffset;
                         Event event;
                         event.setType(i == 0 ? ME_TICK1 : ME_TICK2);
-                        events->insertMulti(tick, event);
+                        ticks.add(tick, event);
                         }
                   if (m->tick() + m->ticks() >= endTick)
                         break;
                   }
             }
+      events->merge(ticks);
       }
 
 //---------------------------------------------------------
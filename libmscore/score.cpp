@@ -89,9 +89,10 @@ bool showRubberBand  = true;
 
 MeasureBaseList::MeasureBaseList()
       {
-      _first = 0;
-      _last  = 0;
-      _size  = 0;
+      _first      = 0;
+      _last       = 0;
+      _size       = 0;
+      _indexValid = false;
       };
 
 //---------------------------------------------------------
@@ -100,6 +101,7 @@ MeasureBaseList::MeasureBaseList()
 
 void MeasureBaseList::push_back(MeasureBase* e)
       {
+      _indexValid = false;
       ++_size;
       if (_last) {
             _last->setNext(e);
@@ -120,6 +122,7 @@ void MeasureBaseList::push_back(MeasureBase* e)
 
 void MeasureBaseList::push_front(MeasureBase* e)
       {
+      _indexValid = false;
       ++_size;
       if (_first) {
             _first->setPrev(e);
@@ -151,6 +154,7 @@ void MeasureBaseList::add(MeasureBase* e)
             return;
             }
       ++_size;
+      _indexValid = false;
       e->setPrev(el->prev());
       el->prev()->setNext(e);
       el->setPrev(e);
@@ -162,6 +166,7 @@ void MeasureBaseList::add(MeasureBase* e)
 
 void MeasureBaseList::remove(MeasureBase* el)
       {
+      _indexValid = false;
       --_size;
       if (el->prev())
             el->prev()->setNext(el->next());
@@ -179,6 +184,7 @@ void MeasureBaseList::remove(MeasureBase* el)
 
 void MeasureBaseList::insert(MeasureBase* fm, MeasureBase* lm)
       {
+      _indexValid = false;
       ++_size;
       for (MeasureBase* m = fm; m != lm; m = m->next())
             ++_size;
@@ -220,6 +226,7 @@ void MeasureBaseList::insert(MeasureBase* fm, MeasureBase* lm)
 
 void MeasureBaseList::remove(MeasureBase* fm, MeasureBase* lm)
       {
+      _indexValid = false;
       --_size;
       for (MeasureBase* m = fm; m != lm; m = m->next())
             --_size;
@@ -235,12 +242,48 @@ void MeasureBaseList::remove(MeasureBase* fm, MeasureBase* lm)
             _last = pm;
       }
 
+//---------------------------------------------------------
+//   upperBound
+//    return the last measure starting at or before tick
+//    or null; measure ticks are read on every lookup, so
+//    the index has only to be rebuild if the list changes
+//---------------------------------------------------------
+
+Measure* MeasureBaseList::upperBound(int tick) const
+      {
+      if (!_indexValid) {
+            _index.resize(0);
+            for (MeasureBase* mb = _first; mb; mb = mb->next()) {
+                  if (mb->type() == MEASURE)
+                        _index.append(static_cast<Measure*>(mb));
+                  }
+            _indexValid = true;
+            }
+      int lo = 0;
+      int hi = _index.size();
+      while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (_index[mid]->tick() <= tick)
+                  lo = mid + 1;
+            else
+                  hi = mid;
+            }
+      if (lo == 0)
+            return 0;
+      // measures with same start tick: return the first one
+      --lo;
+      while (lo > 0 && _index[lo-1]->tick() == _index[lo]->tick())
+            --lo;
+      return _index[lo];
+      }
+
 //---------------------------------------------------------
 //   change
 //---------------------------------------------------------
 
 void MeasureBaseList::change(MeasureBase* ob, MeasureBase* nb)
       {
+      _indexValid = false;
       nb->setPrev(ob->prev());
       nb->setNext(ob->next());
       if (ob->prev())
@@ -295,6 +338,7 @@ void Score::init()
       _symIdx         = 0;
       _pageNumberOffset = 0;
       startLayout     = 0;
+      endLayout       = 0;
       _undo           = new UndoStack();
       _repeatList     = new RepeatList(this);
       foreach(StaffType* st, ::staffTypes)
@@ -963,10 +1007,7 @@ void Score::setLayout(Measure* m)
       {
       if (m)
             m->setDirty();
-      if (startLayout && startLayout != m)
-            setLayoutAll(true);
-      else
-            startLayout = m;
+      reLayout(m);
       }
 
 //---------------------------------------------------------
@@ -2253,6 +2294,7 @@ void Score::splitStaff(int staffIdx, int splitPoint)
       rebuildMidiMapping();
       _instrumentsChanged = true;
       startLayout = 0;
+      endLayout   = 0;
       doLayout();
 
       //
@@ -3008,7 +3050,6 @@ void Score::lassoSelect(const QRectF& bbox)
             QList<const Element*> el = page->items(frr);
             for (int i = 0; i < el.size(); ++i) {
                   const Element* e = el.at(i);
-                  e->itemDiscovered = 0;
                   if (frr.contains(e->abbox())) {
                         if (e->type() != MEASURE && e->selectable())
                               select(const_cast<Element*>(e), SELECT_ADD, 0);
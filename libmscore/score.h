@@ -124,6 +124,9 @@ class MeasureBaseList {
       MeasureBase* _first;
       MeasureBase* _last;
 
+      mutable QVector<Measure*> _index;   ///< measures in list order, for binary search
+      mutable bool _indexValid;           ///< _index is rebuild on next lookup if false
+
       void push_back(MeasureBase* e);
       void push_front(MeasureBase* e);
 
@@ -131,13 +134,14 @@ class MeasureBaseList {
       MeasureBaseList();
       MeasureBase* first() const { return _first; }
       MeasureBase* last()  const { return _last; }
-      void clear()               { _first = _last = 0; _size = 0; }
+      void clear()               { _first = _last = 0; _size = 0; _indexValid = false; }
       void add(MeasureBase*);
       void remove(MeasureBase*);
       void insert(MeasureBase*, MeasureBase*);
       void remove(MeasureBase*, MeasureBase*);
       void change(MeasureBase* o, MeasureBase* n);
       int size() const { return _size; }
+      Measure* upperBound(int tick) const;
       };
 
 //---------------------------------------------------------
@@ -247,6 +251,7 @@ class Score : public QObject {
       int curPage;
       int curSystem;
       MeasureBase* curMeasure;
+      QSet<MeasureBase*> _rowStarts;  // planned first measures of systems
 
       UndoStack* _undo;
 
@@ -274,6 +279,7 @@ class Score : public QObject {
       QRectF refresh;
       bool _updateAll;
       Measure* startLayout;   ///< start a relayout at this measure
+      Measure* endLayout;     ///< last measure modified since last layout
       bool _layoutAll;        ///< do a complete relayout
       LayoutFlags layoutFlags;
       bool _undoRedo;         ///< true if in processing a undo/redo
@@ -296,6 +302,7 @@ class Score : public QObject {
 
       bool _printing;   ///< True if we are drawing to a printer
       bool _playlistDirty;
+      QHash<const Part*, QVector<int> > _eventContext;   ///< context of the cached measure events
       bool _autosaveDirty;
       bool _dirty;      ///< Score data was modified.
       bool _saved;      ///< True if project was already saved; only on first
@@ -377,6 +384,18 @@ class Score : public QObject {
       void layoutStage1();
       void layoutStage2();
       void layoutStage3();
+      void layoutStage1(Measure*, Measure*);
+      void layoutStage2(Measure*, Measure*);
+      void layoutStage3(Measure*, Measure*);
+      void layoutSpanner(Measure*, Measure*);
+      void layoutTracks(void (Score::*stage)(int, Measure*, Measure*), Measure* fm, Measure* em,
+         const QSet<Part*>& serial = QSet<Part*>());
+      void autoBeam(int track, Measure* fm, Measure* em);
+      void layoutBeams(int track, Measure* fm, Measure* em);
+      void computeMinWidths(Measure* fm, Measure* lm);
+      qreal measureWidth(Measure*, bool isFirstMeasure);
+      void planSystemBreaks(Measure* fm, qreal margin, qreal width);
+      void layoutNextRow(qreal w, bool& firstSystem, bool& startWithLongNames);
       void transposeKeys(int staffStart, int staffEnd, int tickStart, int tickEnd, const Interval&);
       void reLayout(Measure*);
 
@@ -653,6 +672,7 @@ class Score : public QObject {
       void pasteStaff(const QDomElement&, ChordRest* dst);
       void toEList(EventMap* events);
       void renderPart(EventMap* events, Part*);
+      void invalidateEventCache(Measure* fm = 0, Measure* lm = 0);
       int mscVersion() const    { return _mscVersion; }
       void setMscVersion(int v) { _mscVersion = v; }
 
@@ -1082,10 +1082,8 @@ void Score::print(QPainter* painter, int pageNo)
       Page* page = pages().at(pageNo);
       QRectF fr  = page->abbox();
 
-      QList<const Element*> ell = page->items(fr);
-      qStableSort(ell.begin(), ell.end(), elementLessThan);
+      QList<const Element*> ell = page->items(fr);     // sorted by z
       foreach(const Element* e, ell) {
-            e->itemDiscovered = 0;
             if (!e->visible())
                   continue;
             painter->save();
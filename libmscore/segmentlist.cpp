@@ -89,6 +89,7 @@ void SegmentList::insert(Segment* e, Segment* el)
             push_front(e);
       else {
             ++_size;
+            _indexValid = false;
             e->setNext(el);
             e->setPrev(el->prev());
             el->prev()->setNext(e);
@@ -106,6 +107,7 @@ void SegmentList::remove(Segment* el)
       if (el->score()->undoRedo())
             qFatal("SegmentList:remove in undo/redo");
       --_size;
+      _indexValid = false;
       if (el == _first) {
             _first = _first->next();
             if (_first)
@@ -132,6 +134,7 @@ void SegmentList::remove(Segment* el)
 void SegmentList::push_back(Segment* e)
       {
       ++_size;
+      _indexValid = false;
       e->setNext(0);
       if (_last)
             _last->setNext(e);
@@ -149,6 +152,7 @@ void SegmentList::push_back(Segment* e)
 void SegmentList::push_front(Segment* e)
       {
       ++_size;
+      _indexValid = false;
       e->setPrev(0);
       if (_first)
             _first->setPrev(e);
@@ -204,6 +208,7 @@ void SegmentList::insert(Segment* seg)
       else
             _last = seg;
       ++_size;
+      _indexValid = false;
       check();
       }
 
@@ -229,4 +234,30 @@ Segment* SegmentList::first(SegmentTypes types) const
       return 0;
       }
 
+//---------------------------------------------------------
+//   lowerBound
+//    return first segment with tick >= tick or null;
+//    segment ticks are read on every lookup, so the index
+//    has only to be rebuild if the list changes
+//---------------------------------------------------------
+
+Segment* SegmentList::lowerBound(int tick) const
+      {
+      if (!_indexValid) {
+            _index.resize(0);
+            for (Segment* s = _first; s; s = s->next())
+                  _index.append(s);
+            _indexValid = true;
+            }
+      int lo = 0;
+      int hi = _index.size();
+      while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (_index[mid]->tick() < tick)
+                  lo = mid + 1;
+            else
+                  hi = mid;
+            }
+      return lo < _index.size() ? _index[lo] : 0;
+      }
 
@@ -26,9 +26,12 @@ class SegmentList {
       Segment* _last;         ///< Last item of segment list
       int _size;              ///< Number of items in segment list
 
+      mutable QVector<Segment*> _index;   ///< segments in list order, for binary search
+      mutable bool _indexValid;           ///< _index is rebuild on next lookup if false
+
    public:
       SegmentList()                        { clear(); }
-      void clear()                         { _first = _last = 0; _size = 0; }
+      void clear()                         { _first = _last = 0; _size = 0; _indexValid = false; }
 #ifndef NDEBUG
       void check();
 #else
@@ -42,6 +45,7 @@ class SegmentList {
 
       Segment* last() const                { return _last;        }
       Segment* firstCRSegment() const;
+      Segment* lowerBound(int tick) const;
       void remove(Segment*);
       void push_back(Segment*);
       void push_front(Segment*);
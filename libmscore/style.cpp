@@ -103,6 +103,7 @@ StyleType styleTypes[] = {
       StyleType("propertyDistance",        ST_SPATIUM),     // note property to note property
 //      StyleType("pageFillLimit",           ST_DOUBLE),      // 0-1.0
       StyleType("lastSystemFillLimit",     ST_DOUBLE),
+      StyleType("planSystemBreaks",        ST_BOOL),        // see Score::planSystemBreaks()
 
       StyleType("hairpinY",                ST_SPATIUM),
       StyleType("hairpinHeight",           ST_SPATIUM),
@@ -462,6 +463,7 @@ StyleData::StyleData()
             StyleVal(ST_propertyDistance,     Spatium(1.0)),
 //            StyleVal(ST_pageFillLimit,        qreal(0.7)),
             StyleVal(ST_lastSystemFillLimit,  qreal(0.3)),
+            StyleVal(ST_planSystemBreaks,     false),
 
             StyleVal(ST_hairpinY, Spatium(8)),
             StyleVal(ST_hairpinHeight, Spatium(1.2)),
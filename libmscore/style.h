@@ -205,6 +205,7 @@ enum StyleIdx {
       ST_propertyDistance,
 //      ST_pageFillLimit,
       ST_lastSystemFillLimit,
+      ST_planSystemBreaks,
 
       ST_hairpinY,
       ST_hairpinHeight,
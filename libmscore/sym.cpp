@@ -24,6 +24,7 @@ static bool symbolsInitialized[2] = { false, false };
 QMap<const char*, SymCode*> charReplaceMap;
 
 static QReadWriteLock gLock;
+static QMutex symbolsMutex;         // serializes initSymbols()
 
 //---------------------------------------------------------
 //   SymbolNames
@@ -653,6 +654,8 @@ QString symToHtml(const Sym& s1, const Sym& s2, int leftMargin)
 
 void initSymbols(int idx)
       {
+      // scores may be laid out concurrently in batch conversion
+      QMutexLocker locker(&symbolsMutex);
       if (symbolsInitialized[idx])
             return;
       symbolsInitialized[idx] = true;
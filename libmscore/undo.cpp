@@ -97,6 +97,37 @@ void updateNoteLines(Segment* segment, int track)
             }
       }
 
+//---------------------------------------------------------
+//   clearEvents
+//    Drop the cached playback events of the measure of
+//    element e (see Score::renderPart()). A tie also
+//    changes the measure of its end note.
+//    Commands which change notes or chords call this so
+//    that the cache is right even if they do not relayout
+//    the measure.
+//    Commands collected from layout on worker threads (see
+//    UndoCollector) leave the cache alone: several threads
+//    may touch the same measure, and end2() has already
+//    dropped the cache of the measures being laid out.
+//---------------------------------------------------------
+
+static void clearEvents(Element* e)
+      {
+      if (UndoCollector::list())
+            return;
+      if (e->type() == TIE) {
+            Note* note = static_cast<Tie*>(e)->endNote();
+            if (note)
+                  clearEvents(note);
+            }
+      for (; e; e = e->parent()) {
+            if (e->type() == MEASURE) {
+                  static_cast<Measure*>(e)->clearEvents();
+                  break;
+                  }
+            }
+      }
+
 //---------------------------------------------------------
 //   UndoCommand
 //---------------------------------------------------------
@@ -216,6 +247,12 @@ void UndoStack::endMacro(bool rollback)
 
 void UndoStack::push(UndoCommand* cmd)
       {
+      QList<UndoCommand*>* cl = UndoCollector::list();
+      if (cl) {
+            cmd->redo();
+            cl->append(cmd);
+            return;
+            }
       if (!curCmd) {
             // this can happen for layout() outside of a command (load)
             // qDebug("UndoStack:push(): no active command, UndoStack %p", this);
@@ -231,6 +268,56 @@ void UndoStack::push(UndoCommand* cmd)
       cmd->redo();
       }
 
+//---------------------------------------------------------
+//   append
+//    add commands which were already executed
+//---------------------------------------------------------
+
+void UndoStack::append(const QList<UndoCommand*>& cl)
+      {
+      foreach(UndoCommand* cmd, cl) {
+            if (curCmd)
+                  curCmd->appendChild(cmd);
+            else
+                  delete cmd;
+            }
+      }
+
+//---------------------------------------------------------
+//   UndoCollector
+//---------------------------------------------------------
+
+struct UndoCollectorData {
+      QList<UndoCommand*>* list;
+      UndoCollectorData() : list(0) {}
+      };
+
+static QThreadStorage<UndoCollectorData*> undoCollector;
+
+static UndoCollectorData* collectorData()
+      {
+      if (!undoCollector.hasLocalData())
+            undoCollector.setLocalData(new UndoCollectorData);
+      return undoCollector.localData();
+      }
+
+UndoCollector::UndoCollector(QList<UndoCommand*>* l)
+      {
+      UndoCollectorData* d = collectorData();
+      saved   = d->list;
+      d->list = l;
+      }
+
+UndoCollector::~UndoCollector()
+      {
+      collectorData()->list = saved;
+      }
+
+QList<UndoCommand*>* UndoCollector::list()
+      {
+      return undoCollector.hasLocalData() ? undoCollector.localData()->list : 0;
+      }
+
 //---------------------------------------------------------
 //   pop
 //---------------------------------------------------------
@@ -1294,6 +1381,7 @@ static void undoAddTuplet(DurationElement* cr)
 
 void AddElement::undo()
       {
+      clearEvents(element);
       element->score()->removeElement(element);
       if (element->type() == TIE) {
             Tie* tie = static_cast<Tie*>(element);
@@ -1317,6 +1405,7 @@ void AddElement::undo()
 void AddElement::redo()
       {
       element->score()->addElement(element);
+      clearEvents(element);
       if (element->type() == TIE) {
             Tie* tie = static_cast<Tie*>(element);
             Measure* m1 = tie->startNote()->chord()->measure();
@@ -1381,6 +1470,7 @@ RemoveElement::RemoveElement(Element* e)
 void RemoveElement::undo()
       {
       element->score()->addElement(element);
+      clearEvents(element);
       if (element->isChordRest()) {
             if (element->type() == CHORD) {
                   Chord* chord = static_cast<Chord*>(element);
@@ -1401,6 +1491,7 @@ void RemoveElement::undo()
 
 void RemoveElement::redo()
       {
+      clearEvents(element);
       element->score()->removeElement(element);
       if (element->isChordRest())
             undoRemoveTuplet(static_cast<ChordRest*>(element));
@@ -1642,6 +1733,7 @@ void ChangePitch::flip()
             }
       if(f_line != line)
             note->setLine(line);
+      clearEvents(note);
 //      if(f_fret != fret)
 //            note->setFret(fret);
 //      if(f_string != string)
@@ -2155,6 +2247,7 @@ void ChangeChordRestLen::flip()
             }
       d   = od;
       cr->score()->setLayout(cr->measure());
+      clearEvents(cr);
       }
 
 //---------------------------------------------------------
@@ -2570,6 +2663,7 @@ void ChangeVelocity::flip()
       note->setVeloOffset(veloOffset);
       veloType   = t;
       veloOffset = o;
+      clearEvents(note);
       }
 
 //---------------------------------------------------------
@@ -2681,6 +2775,7 @@ void ChangeNoteProperties::flip()
       _veloOffset        = v3;
       _onTimeUserOffset  = v6;
       _offTimeUserOffset = v9;
+      clearEvents(note);
       }
 
 //---------------------------------------------------------
@@ -2818,6 +2913,7 @@ void ChangeDuration::flip()
       Fraction od = cr->duration();
       cr->setDuration(d);
       d = od;
+      clearEvents(cr);
       }
 
 //---------------------------------------------------------
@@ -3093,6 +3189,7 @@ void ChangeDurationType::flip()
       TDuration type = cr->durationType();
       cr->setDurationType(t);
       t = type;
+      clearEvents(cr);
       }
 
 //---------------------------------------------------------
@@ -3177,6 +3274,7 @@ void ChangeProperty::flip()
       QVariant v = element->getProperty(id);
       element->setProperty(id, property);
       property = v;
+      clearEvents(element);
       }
 
 //---------------------------------------------------------
@@ -117,6 +117,7 @@ class UndoStack {
       void beginMacro();
       void endMacro(bool rollback);
       void push(UndoCommand*);
+      void append(const QList<UndoCommand*>&);
       void pop();
       void setClean();
       bool canUndo() const          { return curIdx > 0;           }
@@ -127,6 +128,24 @@ class UndoStack {
       void redo();
       };
 
+//---------------------------------------------------------
+//   UndoCollector
+//    While an UndoCollector lives, commands pushed from its
+//    thread are executed but collected in a list instead of
+//    being added to the current command. Layout stages on
+//    worker threads use this; the lists are added later in
+//    a fixed order with UndoStack::append().
+//---------------------------------------------------------
+
+class UndoCollector {
+      QList<UndoCommand*>* saved;
+
+   public:
+      UndoCollector(QList<UndoCommand*>*);
+      ~UndoCollector();
+      static QList<UndoCommand*>* list();
+      };
+
 //---------------------------------------------------------
 //   SaveState
 //---------------------------------------------------------
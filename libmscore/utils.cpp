@@ -41,6 +41,9 @@ QRectF handleRect(const QPointF& pos)
 
 Measure* Score::tick2measure(int tick) const
       {
+      Measure* lm = _measures.upperBound(tick);
+      if (lm && ((tick < lm->endTick()) || (lm->nextMeasure() == 0)))
+            return lm;
       for (MeasureBase* mb = first(); mb;) {
             if (mb->type() != MEASURE) {
                   mb = mb->next();
@@ -79,12 +82,10 @@ Measure* Score::tick2measure(int tick) const
 
 MeasureBase* Score::tick2measureBase(int tick) const
       {
-      for (MeasureBase* mb = first(); mb; mb = mb->next()) {
-            int st = mb->tick();
-            int l  = mb->ticks();
-            if (tick >= st && tick < (st+l))
-                  return mb;
-            }
+      // only measures have a length
+      Measure* m = _measures.upperBound(tick);
+      if (m && (tick < m->endTick()))
+            return m;
 //      qDebug("tick2measureBase %d not found\n", tick);
       return 0;
       }
@@ -100,8 +101,13 @@ Segment* Score::tick2segment(int tick, bool first, SegmentTypes st) const
             qDebug("   no segment for tick %d\n", tick);
             return 0;
             }
-      for (Segment* segment = m->first(st); segment;) {
+      Segment* segment = m->segments()->lowerBound(tick);
+      if (segment && !(segment->subtype() & st))
+            segment = segment->next(st);
+      while (segment) {
             int t1 = segment->tick();
+            if (t1 > tick)
+                  break;
             Segment* nsegment = segment->next(st);
             int t2 = nsegment ? nsegment->tick() : INT_MAX;
             if (((tick == t1) && first) || ((tick == t1) && (tick < t2)))
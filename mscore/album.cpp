@@ -98,10 +98,8 @@ void Album::print()
                   Page* page = pl.at(n);
 
                   QRectF fr = page->abbox();
-                  QList<const Element*> ell = page->items(fr);
-                  qStableSort(ell.begin(), ell.end(), elementLessThan);
+                  QList<const Element*> ell = page->items(fr);     // sorted by z
                   foreach(const Element* e, ell) {
-                        e->itemDiscovered = 0;
                         if (!e->visible())
                               continue;
                         QPointF pos(e->pagePos() - page->pos());
@@ -225,6 +225,7 @@ void EditStyle::getValues()
       lstyle.set(ST_smallClefMag,            smallClefSize->value() * 0.01);
 //      lstyle.set(ST_pageFillLimit,           pageFillThreshold->value() * 0.01);
       lstyle.set(ST_lastSystemFillLimit,     lastSystemFillThreshold->value() * 0.01);
+      lstyle.set(ST_planSystemBreaks,        planSystemBreaks->isChecked());
       lstyle.set(ST_hairpinY,                Spatium(hairpinY->value()));
       lstyle.set(ST_hairpinWidth,            Spatium(hairpinLineWidth->value()));
       lstyle.set(ST_hairpinHeight,           Spatium(hairpinHeight->value()));
@@ -436,6 +437,7 @@ void EditStyle::setValues()
       smallClefSize->setValue(lstyle.value(ST_smallClefMag).toDouble() * 100.0);
 //      pageFillThreshold->setValue(lstyle.value(ST_pageFillLimit).toDouble() * 100.0);
       lastSystemFillThreshold->setValue(lstyle.value(ST_lastSystemFillLimit).toDouble() * 100.0);
+      planSystemBreaks->setChecked(lstyle.value(ST_planSystemBreaks).toBool());
 
       hairpinY->setValue(lstyle.value(ST_hairpinY).toSpatium().val());
       hairpinLineWidth->setValue(lstyle.value(ST_hairpinWidth).toSpatium().val());
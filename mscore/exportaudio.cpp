@@ -32,9 +32,221 @@
 #include "preferences.h"
 #include "seq.h"
 #include "libmscore/mscore.h"
+#include "libmscore/sparm_p.h"
+#include "globals.h"
+
+static const unsigned FRAMES = 512;              // synthesizer chunk size
+static const unsigned BLOCK  = FRAMES * 32;      // frames rendered per stem and round
+
+//---------------------------------------------------------
+//   AudioSink
+//    one output sound file; when normalizing, frames are
+//    spooled to a temporary file and scaled on close()
+//---------------------------------------------------------
+
+class AudioSink {
+      SNDFILE* sf;
+      QTemporaryFile spool;
+      bool normalize;
+      qint64 nframes;
+      bool _ok;
+
+   public:
+      AudioSink(bool n) : sf(0), normalize(n), nframes(0), _ok(true) {}
+      ~AudioSink() { if (sf) sf_close(sf); }
+      bool open(const QString& path, int format, int sampleRate);
+      void write(float* buffer, unsigned frames);
+      bool close(float gain);
+      bool ok() const { return _ok; }
+      };
+
+//---------------------------------------------------------
+//   open
+//---------------------------------------------------------
+
+bool AudioSink::open(const QString& path, int format, int sampleRate)
+      {
+      SF_INFO info;
+      memset(&info, 0, sizeof(info));
+      info.channels   = 2;
+      info.samplerate = sampleRate;
+      info.format     = format;
+      sf = sf_open(qPrintable(path), SFM_WRITE, &info);
+      if (sf == 0) {
+            qDebug("open soundfile <%s> failed: %s\n", qPrintable(path), sf_strerror(sf));
+            return false;
+            }
+      if (normalize && !spool.open()) {
+            qDebug("cannot open audio spool file\n");
+            return false;
+            }
+      return true;
+      }
+
+//---------------------------------------------------------
+//   write
+//---------------------------------------------------------
+
+void AudioSink::write(float* buffer, unsigned frames)
+      {
+      if (!_ok)
+            return;
+      if (normalize) {
+            qint64 n = sizeof(float) * frames * 2;
+            if (spool.write((const char*)buffer, n) != n) {
+                  qDebug("write to audio spool file failed\n");
+                  _ok = false;
+                  }
+            }
+      else
+            sf_writef_float(sf, buffer, frames);
+      nframes += frames;
+      }
+
+//---------------------------------------------------------
+//   close
+//    scale spooled frames by gain and encode them
+//---------------------------------------------------------
+
+bool AudioSink::close(float gain)
+      {
+      if (sf == 0)
+            return false;
+      if (_ok && normalize) {
+            spool.flush();
+            uchar* data = spool.map(0, spool.size());
+            if (data) {
+                  float* p = (float*)data;
+                  for (qint64 i = 0; i < nframes; i += FRAMES) {
+                        sf_count_t n = qMin(qint64(FRAMES), nframes - i);
+                        for (sf_count_t k = 0; k < n * 2; ++k)
+                              p[k] *= gain;
+                        sf_writef_float(sf, p, n);
+                        p += n * 2;
+                        }
+                  spool.unmap(data);
+                  }
+            else {
+                  // mapping not available: stream the spool back in
+                  float buffer[FRAMES * 2];
+                  spool.seek(0);
+                  for (qint64 i = 0; i < nframes; i += FRAMES) {
+                        sf_count_t n = qMin(qint64(FRAMES), nframes - i);
+                        qint64 size  = sizeof(float) * n * 2;
+                        if (spool.read((char*)buffer, size) != size) {
+                              qDebug("read from audio spool file failed\n");
+                              _ok = false;
+                              break;
+                              }
+                        for (sf_count_t k = 0; k < n * 2; ++k)
+                              buffer[k] *= gain;
+                        sf_writef_float(sf, buffer, n);
+                        }
+                  }
+            }
+      int rv = sf_close(sf);
+      sf = 0;
+      if (rv) {
+            qDebug("close soundfile failed\n");
+            _ok = false;
+            }
+      return _ok;
+      }
+
+//---------------------------------------------------------
+//   StemEvent
+//---------------------------------------------------------
+
+struct StemEvent {
+      int frame;
+      int synti;
+      Event event;
+      StemEvent() {}
+      StemEvent(int f, int s, const Event& e) : frame(f), synti(s), event(e) {}
+      };
+
+//---------------------------------------------------------
+//   AudioStem
+//    one part of the score, rendered by its own
+//    synthesizer on a worker thread
+//---------------------------------------------------------
+
+struct AudioStem {
+      const Part* part;
+      MasterSynth* synti;
+      SyntiState state;             // private copy, setState() modifies it
+      bool stateLoaded;
+      QList<StemEvent> init;
+      QList<StemEvent> events;
+      int pos;                      // next event to play
+      int playTime;                 // first frame of current block
+      float* buffer;                // BLOCK frames of output
+      AudioSink* sink;              // optional stem file
+
+      AudioStem() : part(0), synti(0), stateLoaded(false), pos(0), playTime(0), buffer(0), sink(0) {}
+      };
+
+//---------------------------------------------------------
+//   renderStem
+//    render the next BLOCK frames of a stem
+//---------------------------------------------------------
+
+static void renderStem(AudioStem& stem)
+      {
+      MasterSynth* synti = stem.synti;
+      if (!stem.stateLoaded) {
+            synti->setState(stem.state);
+            // offline rendering can afford the best interpolation
+            synti->setParameter(SParmId(FLUID_ID, FluidS::INTERP_GROUP, 0).val,
+               FluidS::FLUID_INTERP_7THORDER);
+            synti->setGain(1.0);
+            foreach(const StemEvent& e, stem.init)
+                  synti->play(e.event, e.synti);
+            stem.stateLoaded = true;
+            }
+      memset(stem.buffer, 0, sizeof(float) * BLOCK * 2);
+      float* p = stem.buffer;
+      int playTime = stem.playTime;
+      for (unsigned block = 0; block < BLOCK; block += FRAMES) {
+            unsigned frames = FRAMES;
+            int endTime = playTime + frames;
+            for (; stem.pos < stem.events.size(); ++stem.pos) {
+                  const StemEvent& e = stem.events[stem.pos];
+                  if (e.frame >= endTime)
+                        break;
+                  int n = qMax(e.frame - playTime, 0);
+                  synti->process(n, p);
+                  p         += 2 * n;
+                  playTime  += n;
+                  frames    -= n;
+                  synti->play(e.event, e.synti);
+                  }
+            if (frames) {
+                  synti->process(frames, p);
+                  p        += 2 * frames;
+                  playTime += frames;
+                  }
+            }
+      stem.playTime = playTime;
+      }
+
+//---------------------------------------------------------
+//   stemFileName
+//---------------------------------------------------------
+
+static QString stemFileName(const QString& name, const QString& ext, int idx, const Part* part)
+      {
+      QFileInfo fi(name);
+      QString partName = part->partName();
+      partName.replace(QRegExp("[^A-Za-z0-9]+"), "_");
+      return QString("%1/%2-%3-%4.%5").arg(fi.path()).arg(fi.completeBaseName())
+         .arg(idx + 1).arg(partName).arg(ext);
+      }
 
 //---------------------------------------------------------
 //   saveAudio
+//    Every part is rendered by its own synthesizer on a
+//    worker thread; the stems are mixed block by block.
 //---------------------------------------------------------
 
 bool MuseScore::saveAudio(Score* score, const QString& name, const QString& ext)
@@ -52,118 +264,133 @@ bool MuseScore::saveAudio(Score* score, const QString& name, const QString& ext)
             }
       int sampleRate = preferences.exportAudioSampleRate;
 
-      MasterSynth* synti = new MasterSynth();
-      synti->init(sampleRate);
-      synti->setState(score->syntiState());
-
-      int oldSampleRate = MScore::sampleRate;
-      MScore::sampleRate = sampleRate;
-
       EventMap events;
       score->toEList(&events);
-
-      SF_INFO info;
-      memset(&info, 0, sizeof(info));
-      info.channels   = 2;
-      info.samplerate = sampleRate;
-      info.format     = format;
-      SNDFILE* sf     = sf_open(qPrintable(name), SFM_WRITE, &info);
-      if (sf == 0) {
-            qDebug("open soundfile failed: %s\n", sf_strerror(sf));
-            delete synti;
-            MScore::sampleRate = oldSampleRate;
+      if (events.isEmpty()) {
+            qDebug("saveAudio: no events to export\n");
             return false;
             }
 
-      QProgressBar* pBar = showProgressBar();
-      pBar->reset();
+      //
+      // split the score into one stem per part
+      //
+      QList<AudioStem> stems;
+      QHash<const Part*, int> stemIdx;
+      foreach(const Part* part, score->parts()) {
+            stemIdx[part] = stems.size();
+            AudioStem stem;
+            stem.part  = part;
+            stem.state = score->syntiState();
+            foreach(const Channel& a, part->instr()->channel()) {
+                  a.updateInitList();
+                  foreach(Event e, a.init) {
+                        if (e.type() == ME_INVALID)
+                              continue;
+                        e.setChannel(a.channel);
+                        int syntiIdx = score->midiMapping(a.channel)->articulation->synti;
+                        stem.init.append(StemEvent(0, syntiIdx, e));
+                        }
+                  }
+            stems.append(stem);
+            }
+      for (EventMap::const_iterator i = events.constBegin(); i != events.constEnd(); ++i) {
+            const Event& e = i->event;
+            if (!e.isChannelEvent())
+                  continue;
+            MidiMapping* mm = score->midiMapping(e.channel());
+            Channel* c = mm->articulation;
+            if (c->mute || !stemIdx.contains(mm->part))
+                  continue;
+            int f = score->utick2utime(i->tick) * sampleRate;
+            stems[stemIdx[mm->part]].events.append(StemEvent(f, c->synti, e));
+            }
 
-      float peak = 0.0;
-      double gain = 1.0;
-      EventMap::const_iterator endPos = events.constEnd();
-      --endPos;
-      const int et = (score->utick2utime(endPos.key()) + 1) * MScore::sampleRate;
-      for (int pass = 0; pass < 2; ++pass) {
-            EventMap::const_iterator playPos;
-            playPos = events.constBegin();
-            pBar->setRange(0, et);
+      const int et = (score->utick2utime(events.back().tick) + 1) * sampleRate;
 
-            //
-            // init instruments
-            //
-            foreach(const Part* part, score->parts()) {
-                  foreach(const Channel& a, part->instr()->channel()) {
-                        a.updateInitList();
-                        foreach(Event e, a.init) {
-                              if (e.type() == ME_INVALID)
-                                    continue;
-                              e.setChannel(a.channel);
-                              int syntiIdx= score->midiMapping(a.channel)->articulation->synti;
-                              synti->play(e, syntiIdx);
-                              }
-                        }
+      //
+      // open output files
+      //
+      bool ok = true;
+      AudioSink mix(exportAudioNormalize);
+      if (!mix.open(name, format, sampleRate))
+            ok = false;
+      for (int i = 0; ok && i < stems.size(); ++i) {
+            AudioStem& stem = stems[i];
+            // synthesizers are initialized here, static tables
+            // in the synthesizer are not thread safe
+            stem.synti = new MasterSynth();
+            stem.synti->init(sampleRate);
+            stem.buffer = new float[BLOCK * 2];
+            if (exportAudioStems) {
+                  stem.sink = new AudioSink(exportAudioNormalize);
+                  if (!stem.sink->open(stemFileName(name, ext, i, stem.part), format, sampleRate))
+                        ok = false;
                   }
+            }
 
-            static const unsigned FRAMES = 512;
-            float buffer[FRAMES * 2];
-            int playTime = 0;
-            synti->setGain(gain);
-
-            for (;;) {
-                  unsigned frames = FRAMES;
-                  //
-                  // collect events for one segment
-                  //
-                  memset(buffer, 0, sizeof(float) * FRAMES * 2);
-                  int endTime = playTime + frames;
-                  float* p = buffer;
-                  for (; playPos != events.constEnd(); ++playPos) {
-                        int f = score->utick2utime(playPos.key()) * MScore::sampleRate;
-                        if (f >= endTime)
-                              break;
-                        int n = f - playTime;
-                        synti->process(n, p);
-                        p         += 2 * n;
-
-                        playTime  += n;
-                        frames    -= n;
-                        const Event& e = playPos.value();
-                        if (e.isChannelEvent()) {
-                              int channelIdx = e.channel();
-                              Channel* c = score->midiMapping(channelIdx)->articulation;
-                              if (!c->mute) {
-                                    synti->play(e, c->synti);
-                                    }
-                              }
-                        }
-                  if (frames) {
-                        synti->process(frames, p);
-                        playTime += frames;
-                        }
-                  if (pass == 1)
-                        sf_writef_float(sf, buffer, FRAMES);
-                  else {
-                        for (unsigned i = 0; i < FRAMES * 2; ++i)
-                              peak = qMax(peak, qAbs(buffer[i]));
-                        }
-                  playTime = endTime;
-                  pBar->setValue(playTime);
-                  if (playTime >= et)
-                        break;
+      // batch conversion may run on worker threads, which
+      // must not touch widgets
+      QProgressBar* pBar = 0;
+      if (QThread::currentThread() == qApp->thread()) {
+            pBar = showProgressBar();
+            pBar->reset();
+            pBar->setRange(0, et);
+            }
+
+      float peak   = 0.0;
+      double sqsum = 0.0;
+      qint64 nframes = 0;
+      float* buffer = new float[BLOCK * 2];
+
+      for (int playTime = 0; ok && playTime < et; playTime += BLOCK) {
+            // blockingMap() also works in the calling thread, so this
+            // does not starve when called from a busy thread pool
+            QtConcurrent::blockingMap(stems, renderStem);
+
+            // the last block is cut at the end of the score
+            unsigned n = qMin(int(BLOCK), et - playTime);
+            memset(buffer, 0, sizeof(float) * n * 2);
+            foreach(const AudioStem& stem, stems) {
+                  for (unsigned i = 0; i < n * 2; ++i)
+                        buffer[i] += stem.buffer[i];
+                  if (stem.sink)
+                        stem.sink->write(stem.buffer, n);
                   }
-            gain = 0.99 / peak;
+            for (unsigned i = 0; i < n * 2; ++i) {
+                  float v = buffer[i];
+                  peak   = qMax(peak, qAbs(v));
+                  sqsum += v * v;
+                  }
+            mix.write(buffer, n);
+            nframes += n;
+            if (pBar)
+                  pBar->setValue(playTime + n);
             }
+      delete[] buffer;
 
-      hideProgressBar();
+      float gain = 1.0;
+      if (exportAudioNormalize && peak > 0.0)
+            gain = 0.99 / peak;
+      if (MScore::debugMode) {
+            qDebug("audio export: %d stems, peak %f rms %f gain %f\n", stems.size(),
+               peak, nframes ? sqrt(sqsum / (nframes * 2)) : 0.0, gain);
+            }
 
-      MScore::sampleRate = oldSampleRate;
-      delete synti;
-      if (sf_close(sf)) {
-            qDebug("close soundfile failed\n");
-            return false;
+      if (!mix.close(gain))
+            ok = false;
+      foreach(const AudioStem& stem, stems) {
+            if (stem.sink) {
+                  if (!stem.sink->close(gain))
+                        ok = false;
+                  delete stem.sink;
+                  }
+            delete stem.synti;
+            delete[] stem.buffer;
             }
 
-      return true;
+      if (pBar)
+            hideProgressBar();
+      return ok;
       }
 
 #endif // HAS_AUDIOFILE
@@ -645,7 +645,6 @@ bool MuseScore::saveMp3(Score* score, const QString& name)
 
       int channels = 2;
 
-      int oldSampleRate = MScore::sampleRate;
       int sampleRate = preferences.exportAudioSampleRate;
 
       exporter.setMode(MODE_CBR);
@@ -660,7 +659,13 @@ bool MuseScore::saveMp3(Score* score, const QString& name)
                      QString::null, QString::null);
                   }
             qDebug("Unable to initialize MP3 stream\n");
-            MScore::sampleRate = oldSampleRate;
+            return false;
+            }
+
+      EventMap events;
+      score->toEList(&events);
+      if (events.isEmpty()) {
+            qDebug("saveMp3: no events to export\n");
             return false;
             }
 
@@ -672,7 +677,6 @@ bool MuseScore::saveMp3(Score* score, const QString& name)
                      tr("Unable to open target file for writing"),
                      QString::null, QString::null);
                   }
-            MScore::sampleRate = oldSampleRate;
             return false;
             }
 
@@ -682,11 +686,13 @@ bool MuseScore::saveMp3(Score* score, const QString& name)
       synti->init(sampleRate);
       synti->setState(score->syntiState());
 
-      EventMap events;
-      score->toEList(&events);
-
-      QProgressBar* pBar = showProgressBar();
-      pBar->reset();
+      // batch conversion may run on worker threads, which
+      // must not touch widgets
+      QProgressBar* pBar = 0;
+      if (QThread::currentThread() == qApp->thread()) {
+            pBar = showProgressBar();
+            pBar->reset();
+            }
 
       static const int FRAMES = 512;
       float bufferL[FRAMES];
@@ -697,11 +703,10 @@ bool MuseScore::saveMp3(Score* score, const QString& name)
       for (int pass = 0; pass < 2; ++pass) {
             EventMap::const_iterator playPos;
             playPos = events.constBegin();
-            EventMap::const_iterator endPos = events.constEnd();
-            --endPos;
-            double et = score->utick2utime(endPos.key());
+            double et = score->utick2utime(events.back().tick);
             et += 1.0;   // add trailer (sec)
-            pBar->setRange(0, int(et));
+            if (pBar)
+                  pBar->setRange(0, int(et));
 
             //
             // init instruments
@@ -735,7 +740,7 @@ bool MuseScore::saveMp3(Score* score, const QString& name)
                   float* r = bufferR;
 
                   for (; playPos != events.constEnd(); ++playPos) {
-                        double f = score->utick2utime(playPos.key());
+                        double f = score->utick2utime(playPos->tick);
                         if (f >= endTime)
                               break;
                         int n = lrint((f - playTime) * sampleRate);
@@ -752,7 +757,7 @@ bool MuseScore::saveMp3(Score* score, const QString& name)
                               playTime += double(n)/double(sampleRate);
                               frames    -= n;
                               }
-                        const Event& e = playPos.value();
+                        const Event& e = playPos->event;
                         if (e.isChannelEvent()) {
                               int channelIdx = e.channel();
                               Channel* c = score->midiMapping(channelIdx)->articulation;
@@ -799,7 +804,8 @@ bool MuseScore::saveMp3(Score* score, const QString& name)
                               }
                         }
                   playTime = endTime;
-                  pBar->setValue(int(playTime));
+                  if (pBar)
+                        pBar->setValue(int(playTime));
                   if (playTime > et)
                         break;
                   }
@@ -810,11 +816,11 @@ bool MuseScore::saveMp3(Score* score, const QString& name)
       if (bytes > 0L)
             file.write((char*)bufferOut, bytes);
 
-      hideProgressBar();
+      if (pBar)
+            hideProgressBar();
       delete synti;
       delete bufferOut;
       file.close();
-      MScore::sampleRate = oldSampleRate;
       return true;
       }
 
@@ -2084,7 +2084,7 @@ bool MuseScore::savePng(Score* score, const QString& name, bool screenshot, bool
             if (!rv)
                   break;
             }
-      cs->setPrinting(false);
+      score->setPrinting(false);
       return rv;
       }
 
@@ -2196,7 +2196,7 @@ bool MuseScore::saveSvg(Score* score, const QString& saveName)
       printer.setTitle(title);
       printer.setDescription(QString("Generated by MuseScore %1").arg(VERSION));
       printer.setFileName(saveName);
-      const PageFormat* pf = cs->pageFormat();
+      const PageFormat* pf = score->pageFormat();
       double mag = converterDpi / MScore::DPI;
 
       qreal w = pf->width() * MScore::DPI * score->pages().size();
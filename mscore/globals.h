@@ -30,6 +30,8 @@ extern bool midiOutputTrace;  ///< debug option: dump midi output
 extern bool noGui;
 extern bool converterMode;
 extern double converterDpi;
+extern bool exportAudioNormalize;   ///< normalize audio export; cmd line option
+extern bool exportAudioStems;       ///< export one audio file per part; cmd line option
 
 //---------------------------------------------------------
 //    ScoreState
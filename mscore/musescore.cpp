@@ -87,6 +87,7 @@
 #include "libmscore/lasso.h"
 
 #include "msynth/synti.h"
+#include "fluid/fluid.h"
 
 MuseScore* mscore;
 
@@ -101,10 +102,14 @@ bool externalIcons = false;
 static bool pluginMode = false;
 static bool startWithNewScore = false;
 double converterDpi = 0;
+bool exportAudioNormalize = true;
+bool exportAudioStems = false;
 
 QString mscoreGlobalShare;
 static QStringList recentScores;
 static QString outFileName;
+static QString jobFile;
+static int converterJobs = 1;
 static QString pluginName;
 static QString styleFile;
 static QString localeName;
@@ -1320,6 +1325,9 @@ static void usage()
         "   -I        dump midi input\n"
         "   -O        dump midi output\n"
         "   -o file   export to 'file'; format depends on file extension\n"
+        "   --job file  convert all scores listed in 'file'; one job per line:\n"
+        "             input output1 [output2 ...]\n"
+        "   -j n      convert n scores of a job file in parallel\n"
         "   -r dpi    set output resolution for image export\n"
         "   -S style  load style file\n"
         "   -p name   execute named plugin\n"
@@ -1327,6 +1335,8 @@ static void usage()
         "   -i        load icons from INSTALLPATH/icons\n"
         "   -e        enable experimental features\n"
         "   -c dir    override config/settings directory\n"
+        "   --no-normalize  do not normalize exported audio\n"
+        "   --stems   also export every part to its own audio file\n"
         );
       exit(-1);
       }
@@ -1988,6 +1998,226 @@ static void loadScores(const QStringList& argv)
       mscore->setCurrentView(1, currentScoreView);
       }
 
+//---------------------------------------------------------
+//   convert
+//    export score to file fn; format depends on extension
+//---------------------------------------------------------
+
+static bool convert(Score* cs, const QString& fn)
+      {
+      if (fn.endsWith(".mscx")) {
+            QFileInfo fi(fn);
+            try {
+                  cs->saveFile(fi);
+                  }
+            catch(QString) {
+                  return false;
+                  }
+            return true;
+            }
+      if (fn.endsWith(".mscz")) {
+            QFileInfo fi(fn);
+            try {
+                  cs->saveCompressedFile(fi, false);
+                  }
+            catch(QString) {
+                  return false;
+                  }
+            return true;
+            }
+      if (fn.endsWith(".xml"))
+            return mscore->saveXml(cs, fn);
+      if (fn.endsWith(".mxl"))
+            return mscore->saveMxl(cs, fn);
+      if (fn.endsWith(".mid"))
+            return mscore->saveMidi(cs, fn);
+      if (fn.endsWith(".pdf"))
+            return mscore->savePsPdf(cs, fn, QPrinter::PdfFormat);
+#if QT_VERSION < 0x050000
+      if (fn.endsWith(".ps"))
+            return mscore->savePsPdf(cs, fn, QPrinter::PostScriptFormat);
+#endif
+      if (fn.endsWith(".png"))
+            return mscore->savePng(cs, fn);
+      if (fn.endsWith(".svg"))
+            return mscore->saveSvg(cs, fn);
+      if (fn.endsWith(".ly"))
+            return mscore->saveLilypond(cs, fn);
+#ifdef HAS_AUDIOFILE
+      if (fn.endsWith(".wav"))
+            return mscore->saveAudio(cs, fn, "wav");
+      if (fn.endsWith(".ogg"))
+            return mscore->saveAudio(cs, fn, "ogg");
+      if (fn.endsWith(".flac"))
+            return mscore->saveAudio(cs, fn, "flac");
+#endif
+      if (fn.endsWith(".mp3"))
+            return mscore->saveMp3(cs, fn);
+      qDebug("dont know how to convert to %s", qPrintable(fn));
+      return false;
+      }
+
+//---------------------------------------------------------
+//   splitJobLine
+//    split a job file line into whitespace separated
+//    fields; fields containing blanks can be quoted
+//---------------------------------------------------------
+
+static QStringList splitJobLine(const QString& line)
+      {
+      QStringList fields;
+      QString field;
+      bool quoted = false;
+      bool inField = false;
+      foreach(QChar c, line) {
+            if (c == '"') {
+                  quoted  = !quoted;
+                  inField = true;
+                  }
+            else if (c.isSpace() && !quoted) {
+                  if (inField)
+                        fields.append(field);
+                  field.clear();
+                  inField = false;
+                  }
+            else {
+                  field.append(c);
+                  inField = true;
+                  }
+            }
+      if (inField)
+            fields.append(field);
+      return fields;
+      }
+
+//---------------------------------------------------------
+//   ConvertJob
+//---------------------------------------------------------
+
+struct ConvertJob {
+      int line;               // line number in job file
+      QString input;
+      QStringList outputs;
+      int failed;             // number of failed outputs
+      };
+
+//---------------------------------------------------------
+//   readJobFile
+//    one job per line:
+//       input output1 [output2 ...]
+//    empty lines and lines starting with '#' are ignored
+//---------------------------------------------------------
+
+static bool readJobFile(const QString& path, QList<ConvertJob>* jobs)
+      {
+      QFile f(path);
+      if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            fprintf(stderr, "cannot open job file <%s>\n", qPrintable(path));
+            return false;
+            }
+      QTextStream ts(&f);
+      ts.setCodec("UTF-8");
+      int lineNo = 0;
+      bool ok = true;
+      while (!ts.atEnd()) {
+            QString line = ts.readLine().trimmed();
+            ++lineNo;
+            if (line.isEmpty() || line.startsWith('#'))
+                  continue;
+            QStringList fields = splitJobLine(line);
+            if (fields.size() < 2) {
+                  fprintf(stderr, "%s:%d: no output file\n", qPrintable(path), lineNo);
+                  ok = false;
+                  continue;
+                  }
+            ConvertJob job;
+            job.line    = lineNo;
+            job.input   = fields.takeFirst();
+            job.outputs = fields;
+            job.failed  = 0;
+            jobs->append(job);
+            }
+      return ok;
+      }
+
+//---------------------------------------------------------
+//   runJob
+//    load one score and write all its outputs; the report
+//    is printed in one piece as jobs may run concurrently
+//---------------------------------------------------------
+
+static QMutex jobReportMutex;
+
+static void runJob(ConvertJob& job)
+      {
+      QString report;
+      QTime t;
+      t.start();
+      Score* score = new Score(MScore::defaultStyle());
+      if (!mscore->readScore(score, job.input)) {
+            report = QString("%1 (line %2): load failed\n").arg(job.input).arg(job.line);
+            job.failed = job.outputs.size();
+            delete score;
+            }
+      else {
+            if (!styleFile.isEmpty()) {
+                  QFile f(styleFile);
+                  if (f.open(QIODevice::ReadOnly))
+                        score->style()->load(&f);
+                  }
+            score->doLayout();
+            report = QString("%1 (line %2): loaded (%3 ms)\n")
+               .arg(job.input).arg(job.line).arg(t.elapsed());
+            foreach(const QString& fn, job.outputs) {
+                  t.restart();
+                  bool rv = convert(score, fn);
+                  report += QString("   %1: %2 (%3 ms)\n")
+                     .arg(fn).arg(rv ? "ok" : "failed").arg(t.elapsed());
+                  if (!rv)
+                        ++job.failed;
+                  }
+            delete score;
+            }
+      QMutexLocker locker(&jobReportMutex);
+      printf("%s", qPrintable(report));
+      fflush(stdout);
+      }
+
+//---------------------------------------------------------
+//   processJobFile
+//    convert all scores listed in a job file; shared
+//    resources (fonts, styles, instrument templates,
+//    preferences) are initialized only once.
+//    With -j N, N scores are converted concurrently.
+//---------------------------------------------------------
+
+static bool processJobFile(const QString& path)
+      {
+      QList<ConvertJob> jobs;
+      bool ok = readJobFile(path, &jobs);
+
+      QTime total;
+      total.start();
+      if (converterJobs > 1) {
+            QThreadPool::globalInstance()->setMaxThreadCount(converterJobs);
+            QtConcurrent::blockingMap(jobs, runJob);
+            }
+      else {
+            for (int i = 0; i < jobs.size(); ++i)
+                  runJob(jobs[i]);
+            }
+
+      int failed  = 0;
+      int outputs = 0;
+      foreach(const ConvertJob& job, jobs) {
+            failed  += job.failed;
+            outputs += job.outputs.size();
+            }
+      printf("%d jobs, %d outputs, %d failed, %d ms\n",
+         jobs.size(), outputs, failed, total.elapsed());
+      return ok && failed == 0;
+      }
+
 //---------------------------------------------------------
 //   processNonGui
 //---------------------------------------------------------
@@ -2015,7 +2245,8 @@ static bool processNonGui()
             }
 
       if (converterMode) {
-            QString fn(outFileName);
+            if (!jobFile.isEmpty())
+                  return processJobFile(jobFile);
             Score* cs = mscore->currentScore();
             if (!styleFile.isEmpty()) {
                   QFile f(styleFile);
@@ -2023,58 +2254,7 @@ static bool processNonGui()
                         cs->style()->load(&f);
                         }
                   }
-            if (fn.endsWith(".mscx")) {
-                  QFileInfo fi(fn);
-                  try {
-                        cs->saveFile(fi);
-                        }
-                  catch(QString) {
-                        return false;
-                        }
-                  return true;
-                  }
-            if (fn.endsWith(".mscz")) {
-                  QFileInfo fi(fn);
-                  try {
-                        cs->saveCompressedFile(fi, false);
-                        }
-                  catch(QString) {
-                        return false;
-                        }
-                  return true;
-                  }
-            if (fn.endsWith(".xml"))
-                  return mscore->saveXml(cs, fn);
-            if (fn.endsWith(".mxl"))
-                  return mscore->saveMxl(cs, fn);
-            if (fn.endsWith(".mid"))
-                  return mscore->saveMidi(cs, fn);
-            if (fn.endsWith(".pdf"))
-                  return mscore->savePsPdf(fn, QPrinter::PdfFormat);
-#if QT_VERSION < 0x050000
-            if (fn.endsWith(".ps"))
-                  return mscore->savePsPdf(fn, QPrinter::PostScriptFormat);
-#endif
-            if (fn.endsWith(".png"))
-                  return mscore->savePng(cs, fn);
-            if (fn.endsWith(".svg"))
-                  return mscore->saveSvg(cs, fn);
-            if (fn.endsWith(".ly"))
-                  return mscore->saveLilypond(cs, fn);
-#ifdef HAS_AUDIOFILE
-            if (fn.endsWith(".wav"))
-                  return mscore->saveAudio(cs, fn, "wav");
-            if (fn.endsWith(".ogg"))
-                  return mscore->saveAudio(cs, fn, "ogg");
-            if (fn.endsWith(".flac"))
-                  return mscore->saveAudio(cs, fn, "flac");
-#endif
-            if (fn.endsWith(".mp3"))
-                  return mscore->saveMp3(cs, fn);
-            else {
-                  qDebug("dont know how to convert to %s", qPrintable(outFileName));
-                  return false;
-                  }
+            return convert(cs, outFileName);
             }
       return true;
       }
@@ -2235,6 +2415,11 @@ int main(int argc, char* av[])
                               usage();
                         styleFile = argv.takeAt(i + 1);
                         break;
+                  case 'j':
+                        if (argv.size() - i < 2)
+                              usage();
+                        converterJobs = qMax(1, argv.takeAt(i + 1).toInt());
+                        break;
                   case 'F':
                         useFactorySettings = true;
                         break;
@@ -2254,6 +2439,21 @@ int main(int argc, char* av[])
                               }
                         }
                         break;
+                  case '-':
+                        if (s == "--no-normalize")
+                              exportAudioNormalize = false;
+                        else if (s == "--stems")
+                              exportAudioStems = true;
+                        else if (s == "--job") {
+                              converterMode = true;
+                              noGui = true;
+                              if (argv.size() - i < 2)
+                                    usage();
+                              jobFile = argv.takeAt(i + 1);
+                              }
+                        else
+                              usage();
+                        break;
                   default:
                         usage();
                   }
@@ -2322,6 +2522,11 @@ int main(int argc, char* av[])
       if (!useFactorySettings)
             preferences.read();
 
+      // decoded samples of compressed (SF3) SoundFonts; the cache
+      // is optional as it can grow large
+      if (preferences.sf3SampleCache)
+            FluidS::Fluid::setSampleCacheDir(dataPath + "/sf3cache");
+
       if (converterDpi == 0)
             converterDpi = preferences.pngResolution;
 
@@ -2409,7 +2614,8 @@ int main(int argc, char* av[])
 
       int files = 0;
       if (noGui) {
-            loadScores(argv);
+            if (jobFile.isEmpty())
+                  loadScores(argv);
             exit(processNonGui() ? 0 : -1);
             }
       else {
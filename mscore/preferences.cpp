@@ -39,6 +39,7 @@
 #include "file.h"
 #include "libmscore/mscore.h"
 #include "shortcut.h"
+#include "fluid/fluid.h"
 #include "plugins.h"
 
 bool useALSA = false, useJACK = false, usePortaudio = false;
@@ -218,6 +219,7 @@ void Preferences::init()
       myTemplatesPath         = QDir(QString("%1/%2").arg(workingDirectory).arg(QCoreApplication::translate("templates_directory", "Templates"))).absolutePath();
       myPluginsPath           = QDir(QString("%1/%2").arg(workingDirectory).arg(QCoreApplication::translate("plugins_directory", "Plugins"))).absolutePath();
       mySoundFontsPath        = QDir(QString("%1/%2").arg(workingDirectory).arg(QCoreApplication::translate("soundfonts_directory", "Soundfonts"))).absolutePath();
+      sf3SampleCache          = false;
 
       nudgeStep10             = 1.0;      // Ctrl + cursor key (default 1.0)
       nudgeStep50             = 5.0;      // Alt  + cursor key (default 5.0)
@@ -360,6 +362,7 @@ void Preferences::write()
       s.setValue("myTemplatesPath", myTemplatesPath);
       s.setValue("myPluginsPath", myPluginsPath);
       s.setValue("mySoundFontsPath", mySoundFontsPath);
+      s.setValue("sf3SampleCache", sf3SampleCache);
 
       s.setValue("hraster", MScore::hRaster());
       s.setValue("vraster", MScore::vRaster());
@@ -521,6 +524,7 @@ void Preferences::read()
       myTemplatesPath  = s.value("myTemplatesPath",  myTemplatesPath).toString();
       myPluginsPath    = s.value("myPluginsPath",    myPluginsPath).toString();
       mySoundFontsPath = s.value("mySoundFontsPath", mySoundFontsPath).toString();
+      sf3SampleCache   = s.value("sf3SampleCache", sf3SampleCache).toBool();
 
       //Create directories if they are missing
       QDir dir;
@@ -998,6 +1002,7 @@ void PreferenceDialog::updateValues(Preferences* p)
       myTemplates->setText(p->myTemplatesPath);
       myPlugins->setText(p->myPluginsPath);
       mySoundFonts->setText(p->mySoundFontsPath);
+      sf3SampleCache->setChecked(p->sf3SampleCache);
 
       nativeDialogs->setChecked(p->nativeDialogs);
       idx = 0;
@@ -1342,6 +1347,8 @@ void PreferenceDialog::apply()
       preferences.myTemplatesPath    = myTemplates->text();
       preferences.myPluginsPath      = myPlugins->text();
       preferences.mySoundFontsPath   = mySoundFonts->text();
+      preferences.sf3SampleCache     = sf3SampleCache->isChecked();
+      FluidS::Fluid::setSampleCacheDir(preferences.sf3SampleCache ? dataPath + "/sf3cache" : QString());
 
       preferences.nativeDialogs      = nativeDialogs->isChecked();
       int idx = exportAudioSampleRate->currentIndex();
@@ -166,6 +166,7 @@ struct Preferences {
       QString myTemplatesPath;
       QString myPluginsPath;
       QString mySoundFontsPath;
+      bool sf3SampleCache;          // keep decoded SF3 samples in dataPath/sf3cache
 
       double nudgeStep10;     // Ctrl + cursor key (default 1.0)
       double nudgeStep50;     // Alt  + cursor key (default 5.0)
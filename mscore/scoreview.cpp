@@ -632,6 +632,7 @@ ScoreView::ScoreView(QWidget* parent)
       _fgColor    = Qt::white;
       fgPixmap    = 0;
       bgPixmap    = 0;
+      tiles.setMaxCost(64 * 1024);        // in KB
       lasso       = new Lasso(_score);
       _foto       = new Lasso(_score);
 
@@ -908,6 +909,7 @@ void ScoreView::setScore(Score* s)
             shadowNote->setScore(_score);
       lasso->setScore(s);
       _foto->setScore(s);
+      tiles.clear();
       if (s)
             s->setLayoutMode(LayoutPage);
       }
@@ -1204,6 +1206,7 @@ void ScoreView::setBackground(QPixmap* pm)
       {
       delete bgPixmap;
       bgPixmap = pm;
+      tiles.clear();
       update();
       }
 
@@ -1212,6 +1215,7 @@ void ScoreView::setBackground(const QColor& color)
       delete bgPixmap;
       bgPixmap = 0;
       _bgColor = color;
+      tiles.clear();
       update();
       }
 
@@ -1223,6 +1227,7 @@ void ScoreView::setForeground(QPixmap* pm)
       {
       delete fgPixmap;
       fgPixmap = pm;
+      tiles.clear();
       update();
       }
 
@@ -1231,6 +1236,7 @@ void ScoreView::setForeground(const QColor& color)
       delete fgPixmap;
       fgPixmap = 0;
       _fgColor = color;
+      tiles.clear();
       update();
       }
 
@@ -1240,6 +1246,7 @@ void ScoreView::setForeground(const QColor& color)
 
 void ScoreView::dataChanged(const QRectF& r)
       {
+      invalidateTiles(r);
       update(_matrix.mapRect(r).toRect());  // generate paint event
       }
 
@@ -1249,9 +1256,28 @@ void ScoreView::dataChanged(const QRectF& r)
 
 void ScoreView::updateAll()
       {
+      tiles.clear();
       update();
       }
 
+//---------------------------------------------------------
+//   invalidateTiles
+//    drop all cached tiles touching the canvas rectangle r
+//---------------------------------------------------------
+
+void ScoreView::invalidateTiles(const QRectF& r)
+      {
+      if (tiles.isEmpty() || r.isEmpty())
+            return;
+      foreach(const TileKey& k, tiles.keys()) {
+            qreal ts = TILE_SIZE / k.mag;
+            qreal aa = 1.0 / k.mag;       // antialiasing may touch one more pixel
+            QRectF tr(k.x * ts - aa, k.y * ts - aa, ts + 2 * aa, ts + 2 * aa);
+            if (tr.intersects(r))
+                  tiles.remove(k);
+            }
+      }
+
 //---------------------------------------------------------
 //   startEdit
 //---------------------------------------------------------
@@ -1851,41 +1877,12 @@ void ScoreView::paintPageBorder(QPainter& p, Page* page)
 void ScoreView::paint(const QRect& r, QPainter& p)
       {
       p.save();
-      if (fgPixmap == 0 || fgPixmap->isNull())
-            p.fillRect(r, _fgColor);
-      else {
-            p.drawTiledPixmap(r, *fgPixmap, r.topLeft()
-               - QPoint(lrint(_matrix.dx()), lrint(_matrix.dy())));
-            }
+      if (useTiles())
+            paintTiles(r, p);
+      else
+            paintPages(r, p, _matrix);
 
       p.setTransform(_matrix);
-      QRectF fr = imatrix.mapRect(QRectF(r));
-
-      QRegion r1(r);
-      if (_score->layoutMode() == LayoutLine) {
-            Page* page = _score->pages().front();
-            QList<const Element*> ell = page->items(fr);
-            qStableSort(ell.begin(), ell.end(), elementLessThan);
-            drawElements(p, ell);
-            }
-      else {
-            foreach (Page* page, _score->pages()) {
-                  if (!score()->printing())
-                        paintPageBorder(p, page);
-                  QRectF pr(page->abbox().translated(page->pos()));
-                  if (pr.right() < fr.left())
-                        continue;
-                  if (pr.left() > fr.right())
-                        break;
-                  QList<const Element*> ell = page->items(fr.translated(-page->pos()));
-                  qStableSort(ell.begin(), ell.end(), elementLessThan);
-                  QPointF pos(page->pos());
-                  p.translate(pos);
-                  drawElements(p, ell);
-                  p.translate(-pos);
-                  r1 -= _matrix.mapRect(pr).toAlignedRect();
-                  }
-            }
       if (dropRectangle.isValid())
             p.fillRect(dropRectangle, QColor(80, 0, 0, 80));
 
@@ -1968,17 +1965,111 @@ void ScoreView::paint(const QRect& r, QPainter& p)
             //
             p.drawLine(QLineF(x2, y1, x2, y2).translated(system2->page()->pos()));
             }
+      p.restore();
+      }
+
+//---------------------------------------------------------
+//   paintPages
+//    draw paper, page elements and desktop background of
+//    the device rectangle r, using matrix to map canvas
+//    to device coordinates
+//---------------------------------------------------------
+
+void ScoreView::paintPages(const QRect& r, QPainter& p, const QTransform& matrix)
+      {
+      p.save();
+      QPoint offset(lrint(matrix.dx()), lrint(matrix.dy()));
+      if (fgPixmap == 0 || fgPixmap->isNull())
+            p.fillRect(r, _fgColor);
+      else
+            p.drawTiledPixmap(r, *fgPixmap, r.topLeft() - offset);
+
+      p.setTransform(matrix);
+      QRectF fr = matrix.inverted().mapRect(QRectF(r));
+
+      QRegion r1(r);
+      if (_score->layoutMode() == LayoutLine) {
+            Page* page = _score->pages().front();
+            drawElements(p, page->drawItems(fr));
+            }
+      else {
+            foreach (Page* page, _score->pages()) {
+                  if (!score()->printing())
+                        paintPageBorder(p, page);
+                  QRectF pr(page->abbox().translated(page->pos()));
+                  if (pr.right() < fr.left())
+                        continue;
+                  if (pr.left() > fr.right())
+                        break;
+                  QVector<BspItem> il = page->drawItems(fr.translated(-page->pos()));
+                  QPointF pos(page->pos());
+                  p.translate(pos);
+                  drawElements(p, il);
+                  p.translate(-pos);
+                  r1 -= matrix.mapRect(pr).toAlignedRect();
+                  }
+            }
       p.setMatrixEnabled(false);
       if ((_score->layoutMode() != LayoutLine) && !r1.isEmpty()) {
             p.setClipRegion(r1);  // only background
             if (bgPixmap == 0 || bgPixmap->isNull())
                   p.fillRect(r, _bgColor);
             else
-                  p.drawTiledPixmap(r, *bgPixmap, r.topLeft() - QPoint(_matrix.m31(), _matrix.m32()));
+                  p.drawTiledPixmap(r, *bgPixmap, r.topLeft() - offset);
             }
       p.restore();
       }
 
+//---------------------------------------------------------
+//   useTiles
+//    edited and dragged elements change without a refresh
+//    of the score; paint them directly
+//---------------------------------------------------------
+
+bool ScoreView::useTiles() const
+      {
+      return !editObject && !dragElement && !score()->printing();
+      }
+
+//---------------------------------------------------------
+//   paintTiles
+//    pages are rendered into TILE_SIZE pixmaps aligned to
+//    the canvas origin; scrolling and cursor movement only
+//    blit cached tiles
+//---------------------------------------------------------
+
+void ScoreView::paintTiles(const QRect& r, QPainter& p)
+      {
+      qreal m = mag();
+      int ox  = lrint(_matrix.dx());
+      int oy  = lrint(_matrix.dy());
+      int x1  = int(floor(qreal(r.left() - ox) / TILE_SIZE));
+      int x2  = int(floor(qreal(r.right() - ox) / TILE_SIZE));
+      int y1  = int(floor(qreal(r.top() - oy) / TILE_SIZE));
+      int y2  = int(floor(qreal(r.bottom() - oy) / TILE_SIZE));
+
+      for (int y = y1; y <= y2; ++y) {
+            for (int x = x1; x <= x2; ++x) {
+                  TileKey key(m, x, y);
+                  QPoint pos(ox + x * TILE_SIZE, oy + y * TILE_SIZE);
+                  QPixmap* pm = tiles.object(key);
+                  if (pm) {
+                        p.drawPixmap(pos, *pm);
+                        continue;
+                        }
+                  pm = new QPixmap(TILE_SIZE, TILE_SIZE);
+                  {
+                  QPainter tp(pm);
+                  tp.setRenderHints(p.renderHints());
+                  paintPages(QRect(0, 0, TILE_SIZE, TILE_SIZE), tp,
+                     QTransform(m, 0.0, 0.0, m, -x * TILE_SIZE, -y * TILE_SIZE));
+                  }
+                  p.drawPixmap(pos, *pm);
+                  tiles.insert(key, pm, TILE_SIZE * TILE_SIZE * pm->depth() / 8192);
+                  }
+            }
+      }
+
 //---------------------------------------------------------
 //   zoom
 //---------------------------------------------------------
@@ -2280,7 +2371,6 @@ Element* ScoreView::elementNear(QPointF p)
       QList<const Element*> el = page->items(r);
       QList<const Element*> ll;
       foreach(const Element* e, el) {
-            e->itemDiscovered = 0;
             if (!e->selectable() || e->type() == PAGE)
                   continue;
             if (e->contains(p))
@@ -2366,15 +2456,15 @@ static void drawDebugInfo(QPainter& p, const Element* e)
 //   drawElements
 //---------------------------------------------------------
 
-void ScoreView::drawElements(QPainter& painter, const QList<const Element*>& el)
+void ScoreView::drawElements(QPainter& painter, const QVector<BspItem>& il)
       {
-      foreach(const Element* e, el) {
-            e->itemDiscovered = 0;
+      for (int i = 0; i < il.size(); ++i) {
+            const Element* e = il[i].element;
             if (!e->visible()) {
                   if (score()->printing() || !score()->showInvisible())
                         continue;
                   }
-            QPointF pos(e->pagePos());
+            const QPointF& pos = il[i].pos;
             painter.translate(pos);
             e->draw(&painter);
             painter.translate(-pos);
@@ -30,6 +30,7 @@ class ChordRest;
 class Rest;
 class Element;
 class Page;
+struct BspItem;
 class Xml;
 class Note;
 class Lasso;
@@ -76,6 +77,25 @@ class Cursor {
       void setTick(int val)          { _tick = val;      }
       };
 
+//---------------------------------------------------------
+//   TileKey
+//    identifies a cached tile of rendered pages; x and y
+//    count tiles in canvas pixels at magnification mag
+//---------------------------------------------------------
+
+struct TileKey {
+      qreal mag;
+      int x, y;
+
+      TileKey(qreal m, int xx, int yy) : mag(m), x(xx), y(yy) {}
+      bool operator==(const TileKey& k) const { return mag == k.mag && x == k.x && y == k.y; }
+      };
+
+inline uint qHash(const TileKey& k)
+      {
+      return qHash(k.x) ^ (qHash(k.y) << 16) ^ qHash(int(k.mag * 1000.0));
+      }
+
 //---------------------------------------------------------
 //   CommandTransition
 //---------------------------------------------------------
@@ -190,8 +210,15 @@ class ScoreView : public QWidget, public MuseScoreView {
       QPixmap* bgPixmap;
       QPixmap* fgPixmap;
 
+      static const int TILE_SIZE = 256;
+      QCache<TileKey, QPixmap> tiles;     ///< rendered pages, see paintTiles()
+
       virtual void paintEvent(QPaintEvent*);
       void paint(const QRect&, QPainter&);
+      void paintPages(const QRect&, QPainter&, const QTransform&);
+      void paintTiles(const QRect&, QPainter&);
+      bool useTiles() const;
+      void invalidateTiles(const QRectF&);
 
       void objectPopup(const QPoint&, Element*);
       void measurePopup(const QPoint&, Measure*);
@@ -219,7 +246,7 @@ class ScoreView : public QWidget, public MuseScoreView {
       Note* searchTieNote(Note* note);
 
       void setShadowNote(const QPointF&);
-      void drawElements(QPainter& p,const QList<const Element*>& el);
+      void drawElements(QPainter& p, const QVector<BspItem>& il);
       bool dragTimeAnchorElement(const QPointF& pos);
       void dragSymbol(const QPointF& pos);
       bool dragMeasureAnchorElement(const QPointF& pos);
@@ -418,6 +445,7 @@ class ScoreView : public QWidget, public MuseScoreView {
       virtual void layoutChanged();
       virtual void dataChanged(const QRectF&);
       virtual void updateAll();
+      void clearTiles()   { tiles.clear(); }
       virtual void adjustCanvasPosition(const Element* el, bool playBack);
       virtual void setCursor(const QCursor& c) { QWidget::setCursor(c); }
       virtual QCursor cursor() const { return QWidget::cursor(); }
@@ -194,9 +194,15 @@ Seq::Seq()
       state    = TRANSPORT_STOP;
       oggInit  = false;
       driver   = 0;
-      playPos  = events.constBegin();
+      playPos  = 0;
+      guiPos   = 0;
+      droppedToGui = 0;
+      skippedVoices = 0;
 
       playTime  = 0;
+      curFrames = 0;
+      guiFrames = 0;
+      nextRelTempo = 0.0;
       metronomeVolume = 0.3;
 
       meterValue[0]     = 0.0;
@@ -387,6 +393,8 @@ bool Seq::init()
             }
       MScore::sampleRate = driver->sampleRate();
       synti->init(MScore::sampleRate);
+      // program changes are processed in the audio thread
+      synti->setAsyncLoading(true);
 
       if (!driver->start()) {
             qDebug("Cannot start I/O");
@@ -489,7 +497,7 @@ void Seq::stop()
       if (cv)
             cv->setCursorOn(false);
       if (cs) {
-            cs->setPlayPos(playPos.key());
+            cs->setPlayPos(posTick(playPos));
             cs->setLayoutAll(false);
             cs->setUpdateAll();
             cs->end();
@@ -653,14 +661,23 @@ void Seq::processMessages()
             switch(msg.id) {
                   case SEQ_TEMPO_CHANGE:
                         {
-                        if (playTime != 0) {
-                              int tick = cs->utime2utick(qreal(playTime) / qreal(MScore::sampleRate));
-                              cs->tempomap()->setRelTempo(msg.data.realVal);
-                              cs->repeatList()->update();
-                              playTime = cs->utick2utime(tick) * MScore::sampleRate;
+                        // the gui thread has stamped buffer idx with the
+                        // new tempo; move playTime to the same position
+                        // between the surrounding events
+                        int idx       = msg.data.intVal;
+                        const int* of = eventFrames[1 - idx].constData();
+                        const int* nf = eventFrames[idx].constData();
+                        int n         = qMin(eventFrames[idx].size(), eventFrames[1 - idx].size());
+                        int p         = qMin(playPos, n);
+                        if (playTime != 0 && n) {
+                              if (p > 0 && p < n && of[p] != of[p-1])
+                                    playTime = nf[p-1] + qint64(playTime - of[p-1]) * (nf[p] - nf[p-1]) / (of[p] - of[p-1]);
+                              else if (p > 0)
+                                    playTime = nf[p-1] + playTime - of[p-1];
+                              else
+                                    playTime = nf[0] - (of[0] - playTime);
                               }
-                        else
-                              cs->tempomap()->setRelTempo(msg.data.realVal);
+                        curFrames.fetchAndStoreRelease(idx);
                         }
                         break;
                   case SEQ_PLAY:
@@ -737,13 +754,16 @@ void Seq::process(unsigned n, float* buffer)
             //
             unsigned framePos = 0;
             int endTime = playTime + frames;
-            for (; playPos != events.constEnd(); ++playPos) {
-                  int f = cs->utick2utime(playPos.key()) * MScore::sampleRate;
+            const SeqEvent* ev = events.constData();
+            const int* fr      = playFrames().constData();
+            const int nevents  = events.size();
+            for (; playPos < nevents; ++playPos) {
+                  int f = fr[playPos];
                   if (f >= endTime)
                         break;
                   int n = f - playTime;
                   if (n < 0) {
-                        qDebug("%d:  %d - %d\n", playPos.key(), f, playTime);
+                        qDebug("%d:  %d - %d\n", ev[playPos].utick, f, playTime);
       			n = 0;
                         }
                   if (n) {
@@ -773,7 +793,7 @@ void Seq::process(unsigned n, float* buffer)
                                     }
                               }
                         }
-                  const Event& event = playPos.value();
+                  const Event& event = ev[playPos].event;
                   playEvent(event);
                   if (event.type() == ME_TICK1)
                         tickRest = tickLength;
@@ -805,7 +825,7 @@ void Seq::process(unsigned n, float* buffer)
                               }
                         }
                   }
-            if (playPos == events.constEnd()) {
+            if (playPos >= nevents) {
                   driver->stopTransport();
                   rewindStart();
                   }
@@ -860,15 +880,17 @@ void Seq::collectEvents()
       //do not collect even while playing
       if (state == TRANSPORT_PLAY)
             return;
-      events.clear();
+      EventMap el;
+      cs->toEList(&el);
 
-      cs->toEList(&events);
-      endTick = 0;
-      if (!events.empty()) {
-            EventMap::const_iterator e = events.constEnd();
-            --e;
-            endTick = e.key();
-            }
+      events.clear();
+      events.reserve(el.size());
+      for (EventMap::const_iterator i = el.constBegin(); i != el.constEnd(); ++i)
+            events.append(SeqEvent(i->tick, i->event));
+      stampFrames(&eventFrames[guiFrames]);
+      playPos = 0;
+      guiPos  = 0;
+      endTick = events.isEmpty() ? 0 : events.last().utick;
 
       PlayPanel* pp = mscore->getPlayPanel();
       if (pp)
@@ -877,13 +899,85 @@ void Seq::collectEvents()
       cs->setPlaylistDirty(false);
       }
 
+//---------------------------------------------------------
+//   stampFrames
+//    compute the play position in samples of all events
+//    with the current tempo map
+//---------------------------------------------------------
+
+void Seq::stampFrames(QVector<int>* frames) const
+      {
+      int n = events.size();
+      frames->resize(n);
+      const SeqEvent* ev = events.constData();
+      int* fr      = frames->data();
+      int lastTick = -1;
+      int frame    = 0;
+      for (int i = 0; i < n; ++i) {
+            if (ev[i].utick != lastTick) {
+                  lastTick = ev[i].utick;
+                  frame    = cs->utick2utime(lastTick) * MScore::sampleRate;
+                  }
+            fr[i] = frame;
+            }
+      }
+
+//---------------------------------------------------------
+//   eventIndex
+//    index of first event at or after utick
+//---------------------------------------------------------
+
+int Seq::eventIndex(int utick) const
+      {
+      int lo = 0;
+      int hi = events.size();
+      while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (events[mid].utick < utick)
+                  lo = mid + 1;
+            else
+                  hi = mid;
+            }
+      return lo;
+      }
+
+//---------------------------------------------------------
+//   posTick
+//    utick of event idx, endTick if past the end
+//---------------------------------------------------------
+
+int Seq::posTick(int idx) const
+      {
+      return idx < events.size() ? events[idx].utick : endTick;
+      }
+
 //---------------------------------------------------------
 //   getCurTick
+//    interpolate between the two events around
+//    the current play position
 //---------------------------------------------------------
 
 int Seq::getCurTick()
       {
-      return cs->utime2utick(qreal(playTime) / qreal(MScore::sampleRate));
+      const QVector<int>& fr = playFrames();
+      int lo = 0;
+      int hi = qMin(events.size(), fr.size());
+      int n  = hi;
+      while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (fr[mid] <= playTime)
+                  lo = mid + 1;
+            else
+                  hi = mid;
+            }
+      if (lo == 0 || lo == n)
+            return cs->utime2utick(qreal(playTime) / qreal(MScore::sampleRate));
+      int f1 = fr[lo - 1];
+      int f2 = fr[lo];
+      int t1 = events[lo - 1].utick;
+      if (f2 == f1)
+            return t1;
+      return t1 + qint64(playTime - f1) * (events[lo].utick - t1) / (f2 - f1);
       }
 
 //---------------------------------------------------------
@@ -908,6 +1002,16 @@ void Seq::processToGuiMessages()
                         mscore->midiCtrlReceived(msg.event.controller(), msg.event.value());
                   }
             }
+      int n = fromSeq.dropped();
+      if (n != droppedToGui) {
+            qDebug("Seq: %d midi input events dropped\n", n - droppedToGui);
+            droppedToGui = n;
+            }
+      n = synti->skippedVoices();
+      if (n != skippedVoices) {
+            qDebug("Seq: %d notes skipped, samples not loaded\n", n - skippedVoices);
+            skippedVoices = n;
+            }
       }
 
 //---------------------------------------------------------
@@ -917,12 +1021,30 @@ void Seq::processToGuiMessages()
 
 void Seq::setRelTempo(double relTempo)
       {
-      SeqMsg msg;
-      msg.data.realVal = relTempo;
-      msg.id    = SEQ_TEMPO_CHANGE;
-      guiToSeq(msg);
+      if (driver && running) {
+            if (guiFrames != curFrames.fetchAndAddAcquire(0)) {
+                  // the last change is not yet switched to; try
+                  // again from heartBeat()
+                  nextRelTempo = relTempo;
+                  return;
+                  }
+            nextRelTempo = 0.0;
+            cs->tempomap()->setRelTempo(relTempo);
+            cs->repeatList()->update();
+            guiFrames = 1 - guiFrames;
+            stampFrames(&eventFrames[guiFrames]);
+            SeqMsg msg;
+            msg.data.intVal = guiFrames;
+            msg.id    = SEQ_TEMPO_CHANGE;
+            guiToSeq(msg);
+            }
+      else {
+            cs->tempomap()->setRelTempo(relTempo);
+            cs->repeatList()->update();
+            stampFrames(&eventFrames[guiFrames]);
+            }
 
-      double t = cs->tempomap()->tempo(playPos.key()) * relTempo;
+      double t = cs->tempomap()->tempo(posTick(playPos)) * relTempo;
 
       PlayPanel* pp = mscore->getPlayPanel();
       if (pp) {
@@ -941,9 +1063,12 @@ void Seq::setPos(int utick)
       {
       stopNotes();
 
-      playTime  = cs->utick2utime(utick) * MScore::sampleRate;
-      playPos   = events.lowerBound(utick);
+      playPos   = eventIndex(utick);
       guiPos    = playPos;
+      if (playPos < events.size() && events[playPos].utick == utick)
+            playTime = playFrames()[playPos];
+      else
+            playTime = cs->utick2utime(utick) * MScore::sampleRate;
       }
 
 //---------------------------------------------------------
@@ -1069,17 +1194,13 @@ void Seq::sendEvent(const Event& ev)
 
 void Seq::nextMeasure()
       {
-      EventMap::const_iterator i = playPos;
       const Note* note = 0;
-      for (;;) {
-            if (i.value().type() == ME_NOTEON) {
-                  const Event& n = i.value();
+      for (int i = qMin(playPos, events.size() - 1); i >= 0; --i) {
+            const Event& n = events[i].event;
+            if (n.type() == ME_NOTEON) {
                   note = n.note();
                   break;
                   }
-            if (i == events.begin())
-                  break;
-            --i;
             }
       if (!note)
             return;
@@ -1087,7 +1208,7 @@ void Seq::nextMeasure()
       m = m->nextMeasure();
       if (m) {
             int rtick = m->tick() - note->chord()->tick();
-            seek(playPos.key() + rtick);
+            seek(posTick(playPos) + rtick);
             }
       }
 
@@ -1097,13 +1218,13 @@ void Seq::nextMeasure()
 
 void Seq::nextChord()
       {
-      int tick = playPos.key();
-      for (EventMap::const_iterator i = playPos; i != events.constEnd(); ++i) {
-            if (i.value().type() != ME_NOTEON)
+      int tick = posTick(playPos);
+      for (int i = playPos; i < events.size(); ++i) {
+            const SeqEvent& e = events[i];
+            if (e.event.type() != ME_NOTEON)
                   continue;
-            const Event& n = i.value();
-            if (i.key() > tick && n.velo()) {
-                  seek(i.key());
+            if (e.utick > tick && e.event.velo()) {
+                  seek(e.utick);
                   break;
                   }
             }
@@ -1115,16 +1236,13 @@ void Seq::nextChord()
 
 void Seq::prevMeasure()
       {
-      EventMap::const_iterator i = playPos;
       const Note* note = 0;
-      for (;;) {
-            if (i.value().type() == ME_NOTEON) {
-                  note = i.value().note();
+      for (int i = qMin(playPos, events.size() - 1); i >= 0; --i) {
+            const Event& n = events[i].event;
+            if (n.type() == ME_NOTEON) {
+                  note = n.note();
                   break;
                   }
-            if (i == events.begin())
-                  break;
-            --i;
             }
       if (!note)
             return;
@@ -1133,7 +1251,7 @@ void Seq::prevMeasure()
 
       if (m) {
             int rtick = note->chord()->tick() - m->tick();
-            seek(playPos.key() - rtick);
+            seek(posTick(playPos) - rtick);
             }
       else
             seek(0);
@@ -1145,35 +1263,32 @@ void Seq::prevMeasure()
 
 void Seq::prevChord()
       {
-      int tick  = playPos.key();
+      if (events.isEmpty())
+            return;
+      int tick  = posTick(playPos);
+      int start = qMin(playPos, events.size() - 1);
       //find the chord just before playpos
-      EventMap::const_iterator i = playPos;
+      int i = start;
       for (;;) {
-            if (i.value().type() == ME_NOTEON) {
-                  const Event& n = i.value();
-                  if (i.key() < tick && n.velo()) {
-                        tick = i.key();
-                        break;
-                        }
+            const SeqEvent& e = events[i];
+            if (e.event.type() == ME_NOTEON && e.utick < tick && e.event.velo()) {
+                  tick = e.utick;
+                  break;
                   }
-            if (i == events.constBegin())
+            if (i == 0)
                   break;
             --i;
             }
       //go the previous chord
-      if (i != events.constBegin()) {
-            i = playPos;
-            for (;;) {
-                  if (i.value().type() == ME_NOTEON) {
-                        const Event& n = i.value();
-                        if (i.key() < tick && n.velo()) {
-                              seek(i.key());
-                              break;
-                              }
+      if (i != 0) {
+            for (i = start; ; --i) {
+                  const SeqEvent& e = events[i];
+                  if (e.event.type() == ME_NOTEON && e.utick < tick && e.event.velo()) {
+                        seek(e.utick);
+                        break;
                         }
-                  if (i == events.constBegin())
+                  if (i == 0)
                         break;
-                  --i;
                   }
             }
       }
@@ -1207,7 +1322,8 @@ void Seq::eventToGui(Event e)
       SeqMsg msg;
       msg.event = e;
       msg.id    = SEQ_MIDI_INPUT_EVENT;
-      fromSeq.enqueue(msg);
+      // called from the midi/audio thread: never wait for the gui
+      fromSeq.tryEnqueue(msg);
       }
 
 //---------------------------------------------------------
@@ -1240,28 +1356,44 @@ SeqMsgFifo::SeqMsgFifo()
       }
 
 //---------------------------------------------------------
-//   enqueue
+//   tryEnqueue
+//    return false and count the message as dropped if
+//    the fifo is full; safe to call from the audio thread
 //---------------------------------------------------------
 
-void SeqMsgFifo::enqueue(const SeqMsg& msg)
+bool SeqMsgFifo::tryEnqueue(const SeqMsg& msg)
       {
-      int i = 0;
-      int n = 50;
+      if (isFull()) {
+            drop();
+            return false;
+            }
+      messages[writeSlot()] = msg;
+      push();
+      return true;
+      }
+
+//---------------------------------------------------------
+//   enqueue
+//    back pressure for the gui side: wait up to 5 sec
+//    for the sequencer to make room before dropping
+//    the message
+//---------------------------------------------------------
 
+bool SeqMsgFifo::enqueue(const SeqMsg& msg)
+      {
+      if (!isFull())
+            return tryEnqueue(msg);
       QMutex mutex;
       QWaitCondition qwc;
       mutex.lock();
-      for (; i < n; ++i) {
-            if (!isFull())
-                  break;
-            qwc.wait(&mutex,100);
-            }
-      if (i == n) {
-            qDebug("===SeqMsgFifo: overflow\n");
-            return;
+      for (int i = 0; i < 5000 && isFull(); ++i)
+            qwc.wait(&mutex, 1);
+      mutex.unlock();
+      if (!tryEnqueue(msg)) {
+            qDebug("===SeqMsgFifo: overflow, %d messages dropped\n", dropped());
+            return false;
             }
-      messages[widx] = msg;
-      push();
+      return true;
       }
 
 //---------------------------------------------------------
@@ -1270,7 +1402,7 @@ void SeqMsgFifo::enqueue(const SeqMsg& msg)
 
 SeqMsg SeqMsgFifo::dequeue()
       {
-      SeqMsg msg = messages[ridx];
+      SeqMsg msg = messages[readSlot()];
       pop();
       return msg;
       }
@@ -1341,6 +1473,8 @@ void Seq::heartBeat()
             sc->setMeter(meterValue[0], meterValue[1], meterPeakValue[0], meterPeakValue[1]);
             }
       processToGuiMessages();
+      if (nextRelTempo != 0.0)
+            setRelTempo(nextRelTempo);
       if (state != TRANSPORT_PLAY)
             return;
       PlayPanel* pp = mscore->getPlayPanel();
@@ -1349,12 +1483,12 @@ void Seq::heartBeat()
             pp->heartBeat2(endTime);
 
       for (;;) {
-            EventMap::const_iterator p = guiPos + 1;
-            if ((p == events.constEnd()) || (p.key() >= playPos.key()))
+            int p = guiPos + 1;
+            if (p >= events.size() || events[p].utick >= posTick(playPos))
                   break;
             guiPos = p;
-            if (guiPos.value().type() == ME_NOTEON) {
-                  Event n = guiPos.value();
+            if (events[guiPos].event.type() == ME_NOTEON) {
+                  Event n = events[guiPos].event;
                   const Note* note1 = n.note();
                   if (n.velo()) {
                         while (note1) {
@@ -1376,7 +1510,7 @@ void Seq::heartBeat()
                   }
             }
 
-      int utick = guiPos.key();
+      int utick = posTick(guiPos);
       int tick = cs->repeatList()->utick2tick(utick);
       mscore->currentScoreView()->moveCursor(tick);
       mscore->setPos(tick);
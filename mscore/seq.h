@@ -68,10 +68,23 @@ class SeqMsgFifo : public FifoBase {
    public:
       SeqMsgFifo();
       virtual ~SeqMsgFifo()     {}
-      void enqueue(const SeqMsg&);        // put object on fifo
+      bool tryEnqueue(const SeqMsg&);     // put object on fifo, never blocks
+      bool enqueue(const SeqMsg&);        // put object on fifo, waits while full
       SeqMsg dequeue();                   // remove object from fifo
       };
 
+//---------------------------------------------------------
+//   SeqEvent
+//    playlist entry
+//---------------------------------------------------------
+
+struct SeqEvent {
+      int utick;
+      Event event;
+      SeqEvent() {}
+      SeqEvent(int t, const Event& e) : utick(t), event(e) {}
+      };
+
 //---------------------------------------------------------
 //   Seq
 //    sequencer
@@ -91,19 +104,33 @@ class Seq : public QObject, public Sequencer {
 
       SeqMsgFifo toSeq;
       SeqMsgFifo fromSeq;
+      int droppedToGui;                   // fromSeq drops already reported
+      int skippedVoices;                  // synthesizer skips already reported
       Driver* driver;
 
       double meterValue[2];
       double meterPeakValue[2];
       int peakTimer[2];
 
-      EventMap events;                    // playlist
+      QVector<SeqEvent> events;           // playlist, sorted by utick
+
+      // Play position in samples of every event, precomputed
+      // so that the real time thread does not need tempo map
+      // lookups. On a tempo change the gui thread stamps the
+      // buffer not in use and sends its index with
+      // SEQ_TEMPO_CHANGE; the real time thread switches
+      // curFrames. A buffer is never written while the real
+      // time thread may read it.
+      QVector<int> eventFrames[2];
+      mutable QAtomicInt curFrames;       // buffer used by the real time thread
+      int guiFrames;                      // buffer last published by the gui thread
+      double nextRelTempo;                // tempo change waiting for a buffer, 0 if none
 
       int playTime;                       // current play position in samples
       int endTick;
 
-      EventMap::const_iterator playPos;   // moved in real time thread
-      EventMap::const_iterator guiPos;    // moved in gui thread
+      int playPos;                        // index into events, moved in real time thread
+      int guiPos;                         // index into events, moved in gui thread
       QList<const Note*> markedNotes;     // notes marked as sounding
 
       uint tackRest;     // metronome state
@@ -114,6 +141,10 @@ class Seq : public QObject, public Sequencer {
       QTimer* noteTimer;
 
       void collectMeasureEvents(Measure*, int staffIdx);
+      void stampFrames(QVector<int>* frames) const;
+      const QVector<int>& playFrames() const { return eventFrames[curFrames.fetchAndAddAcquire(0)]; }
+      int eventIndex(int utick) const;
+      int posTick(int idx) const;
 
       void stopTransport();
       void startTransport();
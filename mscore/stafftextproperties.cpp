@@ -23,6 +23,8 @@
 #include "libmscore/stafftext.h"
 #include "libmscore/system.h"
 #include "libmscore/staff.h"
+#include "libmscore/segment.h"
+#include "libmscore/measure.h"
 
 //---------------------------------------------------------
 // initChannelCombo
@@ -350,5 +352,7 @@ void StaffTextProperties::saveValues()
             }
 
       staffText->score()->updateChannel();
+      Segment* segment = static_cast<Segment*>(staffText->parent());
+      segment->measure()->clearEvents();
       staffText->score()->setPlaylistDirty(true);
       }
@@ -180,7 +180,8 @@ SyntiParameter MasterSynth::parameter(int id) const
 void MasterSynth::setParameter(int id, double val)
       {
       SParmId spid(id);
-      syntis[spid.syntiId]->setParameter(id, val);
+      if (int(spid.syntiId) < syntis.size())
+            syntis[spid.syntiId]->setParameter(id, val);
       }
 
 //---------------------------------------------------------
@@ -227,6 +228,30 @@ void MasterSynth::allNotesOff(int channel)
             synti->allNotesOff(channel);
       }
 
+//---------------------------------------------------------
+//   setAsyncLoading
+//---------------------------------------------------------
+
+void MasterSynth::setAsyncLoading(bool val)
+      {
+      foreach(Synth* synti, syntis)
+            synti->setAsyncLoading(val);
+      }
+
+//---------------------------------------------------------
+//   skippedVoices
+//    number of notes not played because their samples
+//    were not loaded yet
+//---------------------------------------------------------
+
+int MasterSynth::skippedVoices() const
+      {
+      int n = 0;
+      foreach(Synth* synti, syntis)
+            n += synti->skippedVoices();
+      return n;
+      }
+
 //---------------------------------------------------------
 //   synth
 //---------------------------------------------------------
@@ -71,6 +71,10 @@ class Synth {
 
       virtual void allSoundsOff(int /*channel*/) {}
       virtual void allNotesOff(int /*channel*/) {}
+
+      // load instrument samples on a background thread
+      virtual void setAsyncLoading(bool) {}
+      virtual int skippedVoices() const  { return 0; }
       };
 
 //---------------------------------------------------------
@@ -112,6 +116,8 @@ class MasterSynth {
       void reset();
       void allSoundsOff(int channel);
       void allNotesOff(int channel);
+      void setAsyncLoading(bool);
+      int skippedVoices() const;
       };
 
 #endif
@@ -0,0 +1,123 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//  $Id:$
+//
+//  Copyright (C) 2012 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <QtTest/QtTest>
+
+#include "libmscore/element.h"
+#include "libmscore/bsp.h"
+#include "mtest/testutils.h"
+
+typedef QList<const Element*> ElementList;
+
+//---------------------------------------------------------
+//   BspElement
+//    element of any type with a fixed bbox
+//---------------------------------------------------------
+
+class BspElement : public Element {
+      ElementType _type;
+
+   public:
+      BspElement(Score* s, ElementType t) : Element(s), _type(t) {
+            setbbox(QRectF(0.0, 0.0, 10.0, 10.0));
+            }
+      virtual BspElement* clone() const { return new BspElement(*this); }
+      virtual ElementType type() const  { return _type; }
+      void setType(ElementType t)       { _type = t; }
+      };
+
+//---------------------------------------------------------
+//   TestBsp
+//---------------------------------------------------------
+
+class TestBsp : public QObject, public MTest
+      {
+      Q_OBJECT
+
+   private slots:
+      void initTestCase();
+      void bsp();
+      };
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestBsp::initTestCase()
+      {
+      initMTest();
+      }
+
+//---------------------------------------------------------
+//   bsp
+//    insert, move, remove and query elements; an element
+//    has to be reinserted when it moves or when its type
+//    and stacking order change, as for another element
+//    allocated at the address of a deleted one
+//---------------------------------------------------------
+
+void TestBsp::bsp()
+      {
+      BspTree tree;
+      tree.initialize(QRectF(0.0, 0.0, 1000.0, 1000.0), 2);
+
+      BspElement a(score, NOTE);
+      BspElement b(score, TEXT);
+      a.setPos(100.0, 100.0);
+      b.setPos(500.0, 500.0);
+
+   // insert
+      tree.insert(&a);
+      tree.insert(&b);
+      QCOMPARE(tree.count(), 2);
+      QVERIFY(tree.contains(&a));
+      QVERIFY(!tree.changed(&a));
+      QVERIFY(!tree.changed(&b));
+      QCOMPARE(tree.items(QPointF(105.0, 105.0)), ElementList() << &a);
+      QCOMPARE(tree.items(QPointF(505.0, 505.0)), ElementList() << &b);
+      QCOMPARE(tree.items(QPointF(305.0, 305.0)), ElementList());
+      QCOMPARE(tree.items(QRectF(0.0, 0.0, 1000.0, 1000.0)).size(), 2);
+
+   // move
+      a.setPos(800.0, 100.0);
+      QVERIFY(tree.changed(&a));
+      tree.remove(&a);
+      tree.insert(&a);
+      QVERIFY(!tree.changed(&a));
+      QCOMPARE(tree.items(QPointF(105.0, 105.0)), ElementList());
+      QCOMPARE(tree.items(QPointF(805.0, 105.0)), ElementList() << &a);
+
+   // same address, other element
+      a.setType(REST);
+      QVERIFY(tree.changed(&a));
+      tree.remove(&a);
+      tree.insert(&a);
+      QVERIFY(!tree.changed(&a));
+      QCOMPARE(tree.drawItems(QRectF(800.0, 100.0, 10.0, 10.0)).size(), 1);
+      QCOMPARE(tree.drawItems(QRectF(800.0, 100.0, 10.0, 10.0)).at(0).z, a.z());
+
+   // remove
+      tree.remove(&b);
+      QCOMPARE(tree.count(), 1);
+      QVERIFY(!tree.contains(&b));
+      QVERIFY(tree.changed(&b));
+      QCOMPARE(tree.items(QPointF(505.0, 505.0)), ElementList());
+      QCOMPARE(tree.elements(), ElementList() << &a);
+      tree.remove(&b);
+      QCOMPARE(tree.count(), 1);
+      QCOMPARE(tree.items(QRectF(0.0, 0.0, 1000.0, 1000.0)), ElementList() << &a);
+      }
+
+QTEST_MAIN(TestBsp)
+#include "tst_bsp.moc"
+
@@ -14,6 +14,7 @@
 #include <QtTest/QtTest>
 #include "mtest/testutils.h"
 #include "libmscore/score.h"
+#include "libmscore/measure.h"
 
 #define DIR QString("libmscore/layout/")
 
@@ -32,6 +33,7 @@ class TestBenchmark : public QObject, public MTest
       void initTestCase();
       void benchmark1();
       void benchmark2();
+      void benchmark3();
       };
 
 //---------------------------------------------------------
@@ -63,6 +65,24 @@ void TestBenchmark::benchmark2()
             }
       }
 
+//---------------------------------------------------------
+//   benchmark3
+//    incremental relayout of a single measure
+//---------------------------------------------------------
+
+void TestBenchmark::benchmark3()
+      {
+      score->doLayout();
+      Measure* m = score->firstMeasure();
+      for (int i = 0; i < 20 && m->nextMeasure(); ++i)
+            m = m->nextMeasure();
+      QBENCHMARK {
+            score->startCmd();
+            score->setLayoutAll(false);
+            score->setLayout(m);
+            score->endCmd();
+            }
+      }
 
 QTEST_MAIN(TestBenchmark)
 #include "tst_benchmark.moc"
@@ -0,0 +1,291 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//  $Id:$
+//
+//  Copyright (C) 2012 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <QtTest/QtTest>
+#include "mtest/testutils.h"
+#include "libmscore/score.h"
+#include "libmscore/element.h"
+#include "libmscore/mscore.h"
+#include "libmscore/measure.h"
+#include "libmscore/system.h"
+#include "libmscore/page.h"
+#include "libmscore/undo.h"
+
+#define DIR QString("libmscore/layout/")
+
+//---------------------------------------------------------
+//   TestLayout
+//---------------------------------------------------------
+
+class TestLayout : public QObject, public MTest
+      {
+      Q_OBJECT
+
+      QStringList layout(const QString& path, bool parallel);
+      QList<int> breaks(Score*);
+      QStringList pageLayout(Score*);
+      QList<int> sectionSizes(Score*);
+
+   private slots:
+      void initTestCase();
+      void cleanup();
+      void parallelLayout();
+      void planBreaks();
+      void greedyBreaks();
+      void undoBreaks();
+      void reLayout();
+      };
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestLayout::initTestCase()
+      {
+      initMTest();
+      }
+
+void TestLayout::cleanup()
+      {
+      MScore::parallelLayout = true;
+      }
+
+//---------------------------------------------------------
+//   dumpElement
+//---------------------------------------------------------
+
+static void dumpElement(void* data, Element* e)
+      {
+      QStringList* sl = static_cast<QStringList*>(data);
+      QPointF p(e->pagePos());
+      QRectF r(e->bbox());
+      sl->append(QString("%1 %2 %3 %4 %5 %6 %7").arg(e->name()).arg(e->track())
+         .arg(p.x()).arg(p.y()).arg(r.x()).arg(r.width()).arg(r.height()));
+      }
+
+//---------------------------------------------------------
+//   layout
+//    load the score, lay it out and return the position
+//    of all elements
+//---------------------------------------------------------
+
+QStringList TestLayout::layout(const QString& path, bool parallel)
+      {
+      MScore::parallelLayout = parallel;
+      Score* score = readScore(DIR + path);
+      QStringList sl;
+      if (score == 0)
+            return sl;
+      score->doLayout();
+      score->scanElements(&sl, dumpElement);
+      delete score;
+      return sl;
+      }
+
+//---------------------------------------------------------
+//   parallelLayout
+//    parallel layout of a multi voice score with cross
+//    staff beams has to place all elements exactly as the
+//    serial layout
+//---------------------------------------------------------
+
+void TestLayout::parallelLayout()
+      {
+      QStringList serial = layout("crossstaff.mscx", false);
+      QVERIFY(!serial.isEmpty());
+      for (int i = 0; i < 10; ++i) {
+            QStringList parallel = layout("crossstaff.mscx", true);
+            QCOMPARE(parallel, serial);
+            }
+      }
+
+//---------------------------------------------------------
+//   breaks
+//    number of the first measure of every system
+//---------------------------------------------------------
+
+QList<int> TestLayout::breaks(Score* score)
+      {
+      QList<int> bl;
+      foreach(System* system, *score->systems()) {
+            foreach(MeasureBase* mb, system->measures()) {
+                  if (mb->type() == MEASURE) {
+                        bl.append(static_cast<Measure*>(mb)->no() + 1);
+                        break;
+                        }
+                  }
+            }
+      return bl;
+      }
+
+//---------------------------------------------------------
+//   sectionSizes
+//    number of measures of the systems between the line
+//    breaks after measure 2 and 15 of breaks.mscx
+//---------------------------------------------------------
+
+QList<int> TestLayout::sectionSizes(Score* score)
+      {
+      QList<int> bl = breaks(score);
+      QList<int> sizes;
+      if (!bl.contains(3) || !bl.contains(16))
+            return sizes;
+      for (int i = bl.indexOf(3); bl[i] != 16; ++i)
+            sizes.append(bl[i + 1] - bl[i]);
+      return sizes;
+      }
+
+//---------------------------------------------------------
+//   planBreaks
+//    breaks.mscx has 13 equal measures between line breaks
+//    after measure 2 and 15 and sets planSystemBreaks;
+//    planned breaks share them out evenly where filling
+//    systems one by one would leave a short last system
+//---------------------------------------------------------
+
+void TestLayout::planBreaks()
+      {
+      Score* score = readScore(DIR + "breaks.mscx");
+      QVERIFY(score);
+      QVERIFY(score->styleB(ST_planSystemBreaks));
+      score->doLayout();
+      QList<int> sizes = sectionSizes(score);
+      QVERIFY(sizes.size() > 1);
+      qSort(sizes);
+      QVERIFY(sizes.last() - sizes.first() <= 1);
+      delete score;
+      }
+
+//---------------------------------------------------------
+//   greedyBreaks
+//    without planSystemBreaks every system but the last
+//    one of a section is filled
+//---------------------------------------------------------
+
+void TestLayout::greedyBreaks()
+      {
+      Score* score = readScore(DIR + "breaks.mscx");
+      QVERIFY(score);
+      score->doLayout();
+      QList<int> planned = sectionSizes(score);
+      qSort(planned);
+
+      score->style()->set(StyleVal(ST_planSystemBreaks, false));
+      score->doLayout();
+      QList<int> sizes = sectionSizes(score);
+      QVERIFY(sizes.size() > 1);
+      for (int i = 1; i < sizes.size() - 1; ++i)
+            QCOMPARE(sizes[i], sizes[0]);
+      QVERIFY(sizes.last() <= sizes[0]);
+      QVERIFY(sizes[0] >= planned.last());
+      delete score;
+      }
+
+//---------------------------------------------------------
+//   undoBreaks
+//    the breaks of a loaded score do not change by a
+//    relayout, by an edit and its undo, or by an
+//    incremental relayout
+//---------------------------------------------------------
+
+void TestLayout::undoBreaks()
+      {
+      Score* score = readScore(DIR + "breaks.mscx");
+      QVERIFY(score);
+      score->doLayout();
+      QList<int> bl = breaks(score);
+
+      score->doLayout();
+      QCOMPARE(breaks(score), bl);
+
+      Measure* m = score->firstMeasure();
+      for (int i = 0; i < 5; ++i)
+            m = m->nextMeasure();
+      score->startCmd();
+      score->undo(new ChangeStretch(m, 3.0));
+      score->endCmd();
+
+      score->setLayoutAll(false);
+      score->undo()->undo();
+      score->endUndoRedo();
+      QCOMPARE(breaks(score), bl);
+
+      score->startCmd();
+      score->setLayoutAll(false);
+      score->setLayout(m);
+      score->endCmd();
+      QCOMPARE(breaks(score), bl);
+      delete score;
+      }
+
+//---------------------------------------------------------
+//   pageLayout
+//    page, system and position of every measure
+//---------------------------------------------------------
+
+QStringList TestLayout::pageLayout(Score* score)
+      {
+      QStringList sl;
+      foreach(Page* page, score->pages()) {
+            foreach(System* system, *page->systems()) {
+                  foreach(MeasureBase* mb, system->measures()) {
+                        if (mb->type() != MEASURE)
+                              continue;
+                        QPointF p(mb->pagePos());
+                        sl.append(QString("%1 %2 %3 %4 %5 %6").arg(page->no())
+                           .arg(system->y()).arg(static_cast<Measure*>(mb)->no())
+                           .arg(p.x()).arg(p.y()).arg(mb->width()));
+                        }
+                  }
+            }
+      return sl;
+      }
+
+//---------------------------------------------------------
+//   reLayout
+//    after editing a measure the incremental relayout in
+//    end() has to break systems and pages and place the
+//    measures exactly as a full layout
+//---------------------------------------------------------
+
+void TestLayout::reLayout()
+      {
+      Score* score = readScore(DIR + "relayout.mscx");
+      QVERIFY(score);
+      score->doLayout();
+      QVERIFY(score->pages().size() > 1);
+
+      static const int measures[] = { 2, 40, 61, 118 };
+      static const qreal stretch[] = { 4.0, 1.0 };
+      for (unsigned i = 0; i < sizeof(measures)/sizeof(*measures); ++i) {
+            Measure* m = score->firstMeasure();
+            for (int k = 0; k < measures[i]; ++k)
+                  m = m->nextMeasure();
+            for (unsigned k = 0; k < sizeof(stretch)/sizeof(*stretch); ++k) {
+                  m->setUserStretch(stretch[k]);
+                  score->startCmd();
+                  score->setLayoutAll(false);
+                  score->setLayout(m);
+                  score->endCmd();
+                  QStringList sl = pageLayout(score);
+
+                  score->doLayout();
+                  QCOMPARE(sl, pageLayout(score));
+                  }
+            }
+      delete score;
+      }
+
+QTEST_MAIN(TestLayout)
+#include "tst_layout.moc"
+
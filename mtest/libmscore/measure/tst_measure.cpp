@@ -42,6 +42,7 @@ class TestMeasure : public QObject, public MTest
       void insertMeasureMiddle();
       void insertMeasureBegin();
       void insertMeasureEnd();
+      void tick2measure();
       };
 
 //---------------------------------------------------------
@@ -109,6 +110,54 @@ void TestMeasure::insertMeasureEnd()
       delete score;
       }
 
+//---------------------------------------------------------
+//   checkTickIndex
+//    compare index based lookup with the measure list
+//---------------------------------------------------------
+
+static bool checkTickIndex(Score* score)
+      {
+      for (Measure* m = score->firstMeasure(); m; m = m->nextMeasure()) {
+            if (score->tick2measure(m->tick()) != m
+               || score->tick2measure(m->endTick() - 1) != m
+               || score->tick2measureBase(m->tick()) != m)
+                  return false;
+            for (Segment* s = m->first(); s; s = s->next()) {
+                  Segment* fs = m->findSegment(s->subtype(), s->tick());
+                  if (fs == 0 || fs->tick() != s->tick() || fs->subtype() != s->subtype())
+                        return false;
+                  }
+            }
+      return true;
+      }
+
+//---------------------------------------------------------
+//   tick2measure
+//    tick index must follow insert/remove measure undo ops
+//---------------------------------------------------------
+
+void TestMeasure::tick2measure()
+      {
+      Score* score = readScore(DIR + "measure1.mscx");
+      score->doLayout();
+      QVERIFY(checkTickIndex(score));
+
+      Measure* m = score->firstMeasure()->nextMeasure();
+      score->startCmd();
+      score->insertMeasure(MEASURE, m);
+      score->endCmd();
+      QVERIFY(checkTickIndex(score));
+
+      score->undo()->undo();
+      score->doLayout();
+      QVERIFY(checkTickIndex(score));
+
+      score->undo()->redo();
+      score->doLayout();
+      QVERIFY(checkTickIndex(score));
+      delete score;
+      }
+
 QTEST_MAIN(TestMeasure)
 
 #include "tst_measure.moc"
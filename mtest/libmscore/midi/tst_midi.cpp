@@ -22,6 +22,8 @@
 #include "libmscore/note.h"
 #include "libmscore/keysig.h"
 #include "libmscore/exportmidi.h"
+#include "libmscore/event.h"
+#include "libmscore/undo.h"
 
 #include "mtest/mcursor.h"
 #include "mtest/testutils.h"
@@ -41,6 +43,11 @@ class TestMidi : public QObject, public MTest
       void midi1();
       void midi2();
       void midi3();
+      void eventCache();
+      void eventMapSort();
+      void eventMapMerge();
+      void eventMapFind();
+      void eventMapScore();
       };
 
 //---------------------------------------------------------
@@ -281,6 +288,248 @@ void TestMidi::midi3()
       delete score2;
       }
 
+//---------------------------------------------------------
+//   dumpEvents
+//---------------------------------------------------------
+
+static QStringList dumpEvents(const EventMap& events)
+      {
+      QStringList sl;
+      foreach(const TimedEvent& e, events) {
+            sl.append(QString("%1 %2 %3 %4 %5").arg(e.tick).arg(e.event.type())
+               .arg(e.event.channel()).arg(e.event.pitch()).arg(e.event.velo()));
+            }
+      return sl;
+      }
+
+//---------------------------------------------------------
+//   eventCache
+//    an edit through the undo stack has to drop the
+//    cached events of the changed measure
+//---------------------------------------------------------
+
+void TestMidi::eventCache()
+      {
+      MCursor c;
+      c.createScore("test4");
+      c.addPart("voice");
+      c.move(0, 0);     // move to track 0 tick 0
+
+      c.addKeySig(0);
+      c.addTimeSig(Fraction(4,4));
+      for (int i = 0; i < 8; ++i)
+            c.addChord(60 + i, TDuration(TDuration::V_QUARTER));
+      Score* score = c.score();
+
+      score->doLayout();
+      score->rebuildMidiMapping();
+
+      EventMap warm;
+      score->toEList(&warm);
+
+      Measure* m     = score->firstMeasure()->nextMeasure();
+      Segment* s     = m->first(SegChordRest);
+      Chord* chord   = static_cast<Chord*>(s->element(0));
+      Note* note     = chord->upNote();
+      score->startCmd();
+      score->undo(new ChangeVelocity(note, USER_VAL, 30));
+      score->endCmd();
+
+      EventMap edited;
+      score->toEList(&edited);
+      score->invalidateEventCache();
+      EventMap cold;
+      score->toEList(&cold);
+
+      QStringList sl = dumpEvents(edited);
+      QCOMPARE(sl, dumpEvents(cold));
+      QVERIFY(sl != dumpEvents(warm));
+      bool found = false;
+      foreach(const TimedEvent& e, edited) {
+            if (e.tick == s->tick() && e.event.type() == ME_NOTEON
+               && e.event.pitch() == note->ppitch() && e.event.velo() == 30)
+                  found = true;
+            }
+      QVERIFY(found);
+
+      delete score;
+      }
+
+//---------------------------------------------------------
+//   noteOn
+//---------------------------------------------------------
+
+static Event noteOn(int pitch)
+      {
+      Event e(ME_NOTEON);
+      e.setPitch(pitch);
+      e.setVelo(80);
+      return e;
+      }
+
+//---------------------------------------------------------
+//   pitches
+//---------------------------------------------------------
+
+static QList<int> pitches(const EventMap& events)
+      {
+      QList<int> l;
+      foreach(const TimedEvent& e, events)
+            l.append(e.event.pitch());
+      return l;
+      }
+
+//---------------------------------------------------------
+//   eventMapSort
+//    sort() orders by tick and keeps the order in which
+//    events with the same tick were added
+//---------------------------------------------------------
+
+void TestMidi::eventMapSort()
+      {
+      EventMap events;
+      events.add(480, noteOn(60));
+      events.add(0,   noteOn(61));
+      events.add(480, noteOn(62));
+      events.add(0,   noteOn(63));
+      events.add(240, noteOn(64));
+      events.add(480, noteOn(65));
+      events.sort();
+      QCOMPARE(pitches(events), QList<int>() << 61 << 63 << 64 << 60 << 62 << 65);
+
+      EventMap offset;
+      offset.add(events, 960);
+      QCOMPARE(offset.size(), events.size());
+      QCOMPARE(offset.front().tick, 960);
+      QCOMPARE(offset.back().tick, 1440);
+      QCOMPARE(pitches(offset), pitches(events));
+      }
+
+//---------------------------------------------------------
+//   eventMapMerge
+//    merging sorted streams keeps them sorted; on the same
+//    tick the events already in the map come first, so the
+//    metronome ticks merged last follow all part events
+//---------------------------------------------------------
+
+void TestMidi::eventMapMerge()
+      {
+      EventMap part1;
+      part1.add(0,   noteOn(60));
+      part1.add(0,   noteOn(64));
+      part1.add(480, noteOn(62));
+      part1.add(960, noteOn(64));
+      EventMap part2;
+      part2.add(0,    noteOn(70));
+      part2.add(480,  noteOn(72));
+      part2.add(1440, noteOn(74));
+      EventMap ticks;
+      for (int i = 0; i < 4; ++i)
+            ticks.add(i * 480, Event(i == 0 ? ME_TICK1 : ME_TICK2));
+
+      EventMap events;
+      events.merge(EventMap());
+      QVERIFY(events.isEmpty());
+      events.merge(part1);
+      events.merge(part2);
+      QCOMPARE(pitches(events), QList<int>() << 60 << 64 << 70 << 62 << 72 << 64 << 74);
+      events.merge(EventMap());
+      QCOMPARE(events.size(), 7);
+
+      events.merge(ticks);
+      QCOMPARE(events.size(), 11);
+      QStringList sl;
+      foreach(const TimedEvent& e, events) {
+            bool tick = e.event.type() == ME_TICK1 || e.event.type() == ME_TICK2;
+            sl.append(QString("%1 %2").arg(e.tick).arg(tick ? 0 : e.event.pitch()));
+            }
+      QCOMPARE(sl, QStringList() << "0 60" << "0 64" << "0 70" << "0 0"
+         << "480 62" << "480 72" << "480 0" << "960 64" << "960 0"
+         << "1440 74" << "1440 0");
+
+      // a stream starting at the end of the map is appended
+      EventMap tail;
+      tail.add(1440, noteOn(76));
+      tail.add(1920, noteOn(77));
+      events.merge(tail);
+      QCOMPARE(events.size(), 13);
+      QCOMPARE(events.at(11).event.pitch(), 76);
+      QCOMPARE(events.at(12).tick, 1920);
+      }
+
+//---------------------------------------------------------
+//   eventMapFind
+//    find() returns the first event at or after tick
+//---------------------------------------------------------
+
+void TestMidi::eventMapFind()
+      {
+      EventMap events;
+      QVERIFY(events.find(0) == events.constEnd());
+
+      events.add(480, noteOn(60));
+      events.add(480, noteOn(61));
+      events.add(960, noteOn(62));
+      events.add(1920, noteOn(63));
+
+      QVERIFY(events.find(-1) == events.constBegin());
+      QVERIFY(events.find(0) == events.constBegin());
+      QVERIFY(events.find(480) == events.constBegin());
+      QCOMPARE(events.find(481)->event.pitch(), 62);
+      QCOMPARE(events.find(960)->event.pitch(), 62);
+      QCOMPARE(events.find(961)->event.pitch(), 63);
+      QCOMPARE(events.find(1920)->event.pitch(), 63);
+      QVERIFY(events.find(1921) == events.constEnd());
+      }
+
+//---------------------------------------------------------
+//   eventMapScore
+//    toEList() is the stable merge of the part streams
+//    in part order followed by the metronome ticks
+//---------------------------------------------------------
+
+void TestMidi::eventMapScore()
+      {
+      MCursor c;
+      c.createScore("test5");
+      c.addPart("voice");
+      c.addPart("voice");
+      c.move(0, 0);
+
+      c.addKeySig(0);
+      c.addTimeSig(Fraction(4,4));
+      for (int i = 0; i < 8; ++i)
+            c.addChord(60 + i, TDuration(TDuration::V_QUARTER));
+      c.move(VOICES, 0);
+      for (int i = 0; i < 4; ++i)
+            c.addChord(48 + i, TDuration(TDuration::V_HALF));
+      Score* score = c.score();
+
+      score->doLayout();
+      score->rebuildMidiMapping();
+
+      EventMap events;
+      score->toEList(&events);
+
+      EventMap expected;
+      foreach(Part* part, score->parts()) {
+            EventMap el;
+            score->renderPart(&el, part);
+            QVERIFY(!el.isEmpty());
+            expected += el;
+            }
+      int n = expected.size();
+      foreach(const TimedEvent& e, events) {
+            if (e.event.type() == ME_TICK1 || e.event.type() == ME_TICK2)
+                  expected.append(e);
+            }
+      QCOMPARE(expected.size() - n, 8);
+      expected.sort();
+      QCOMPARE(dumpEvents(events), dumpEvents(expected));
+
+      delete score;
+      }
+
 QTEST_MAIN(TestMidi)
 
 #include "tst_midi.moc"
@@ -0,0 +1,114 @@
+#=============================================================================
+#  MuseScore
+#  Music Composition & Notation
+#  $Id:$
+#
+#  Copyright (C) 2012 Werner Schweer
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License version 2
+#  as published by the Free Software Foundation and appearing in
+#  the file LICENSE.GPL
+#=============================================================================
+
+#
+#  convert scores with a job file, once serially and once
+#  with -j 3, and check that both runs write the same
+#  outputs and report the same results
+#     -D MSCORE=<mscore binary> -D SCORE=<score> -D SCORE2=<score>
+#     -D OUT=<directory> [-D AUDIO=1]
+#
+
+set(WAV_A "")
+set(WAV_C "")
+if (AUDIO)
+      set(WAV_A " a.wav")
+      set(WAV_C " c.wav")
+endif (AUDIO)
+
+file(REMOVE_RECURSE ${OUT})
+file(MAKE_DIRECTORY ${OUT}/serial)
+file(MAKE_DIRECTORY ${OUT}/parallel)
+# outputs are relative to the working directory of each run
+file(WRITE ${OUT}/test.job
+      "# outputs of two scores\n"
+      "\"${SCORE}\" a.png a.svg${WAV_A}\n"
+      "\n"
+      "\"${SCORE}\" b.svg b.png\n"
+      "\"${SCORE2}\" c.png c.svg${WAV_C}\n"
+      "\"${SCORE2}\" d.svg\n"
+      )
+
+#
+#  runJob
+#    run the job file in OUT/dir; the report without
+#    timings and with the job reports sorted is returned
+#    in report
+#
+
+function(runJob dir report)
+      execute_process(
+            COMMAND ${MSCORE} ${ARGN} --job ${OUT}/test.job
+            WORKING_DIRECTORY ${OUT}/${dir}
+            RESULT_VARIABLE result
+            OUTPUT_VARIABLE output
+            ERROR_VARIABLE  errors
+            )
+      message("${dir}:\n${output}${errors}")
+      if (NOT output MATCHES "4 jobs, ")
+            message(FATAL_ERROR "${dir}: no job summary, result ${result}")
+      endif (NOT output MATCHES "4 jobs, ")
+      # jobs may finish in any order; each job report is printed
+      # in one piece starting with an unindented line
+      string(REGEX REPLACE " *\\(?[0-9]+ ms\\)?" "" output "${output}")
+      string(REGEX REPLACE "\n([^ ])" "\n;\\1" output "${output}")
+      list(SORT output)
+      set(${report} "${output}" PARENT_SCOPE)
+endfunction(runJob)
+
+runJob(serial serialReport)
+runJob(parallel parallelReport -j 3)
+if (NOT serialReport STREQUAL parallelReport)
+      message(FATAL_ERROR "reports differ:\n${serialReport}\n---\n${parallelReport}")
+endif (NOT serialReport STREQUAL parallelReport)
+
+#
+#  images have to be written by both runs and be equal
+#
+foreach(f a-1.png a.svg b-1.png b.svg c-1.png c.svg d.svg)
+      foreach(dir serial parallel)
+            if (NOT EXISTS ${OUT}/${dir}/${f})
+                  message(FATAL_ERROR "${dir}: ${f} not written")
+            endif (NOT EXISTS ${OUT}/${dir}/${f})
+      endforeach(dir)
+      file(READ ${OUT}/serial/${f} s HEX)
+      file(READ ${OUT}/parallel/${f} p HEX)
+      if (s STREQUAL "")
+            message(FATAL_ERROR "${f} is empty")
+      endif (s STREQUAL "")
+      if (NOT s STREQUAL p)
+            message(FATAL_ERROR "${f} differs between serial and parallel run")
+      endif (NOT s STREQUAL p)
+endforeach(f)
+
+#
+#  audio depends on the installed soundfont; if the serial
+#  run wrote it, the parallel run has to write the same
+#  amount
+#
+if (AUDIO)
+      foreach(f a.wav c.wav)
+            if (EXISTS ${OUT}/serial/${f})
+                  if (NOT EXISTS ${OUT}/parallel/${f})
+                        message(FATAL_ERROR "parallel: ${f} not written")
+                  endif (NOT EXISTS ${OUT}/parallel/${f})
+                  file(READ ${OUT}/serial/${f} s HEX)
+                  file(READ ${OUT}/parallel/${f} p HEX)
+                  string(LENGTH "${s}" sl)
+                  string(LENGTH "${p}" pl)
+                  if (NOT sl EQUAL pl)
+                        message(FATAL_ERROR "${f}: ${sl} and ${pl} hex digits")
+                  endif (NOT sl EQUAL pl)
+            endif (EXISTS ${OUT}/serial/${f})
+      endforeach(f)
+endif (AUDIO)
@@ -13,6 +13,11 @@
 
 #include <QtTest/QtTest>
 #include "mtest/testutils.h"
+#include "libmscore/score.h"
+#include "libmscore/sym.h"
+#include "omr/omr.h"
+#include "omr/pdf.h"
+#include "omr/pattern.h"
 
 #define DIR QString("omr/notes/")
 
@@ -30,6 +35,7 @@ class TestNotes : public QObject, public MTest
       void initTestCase();
       void notes2() { omrFileTest("notes2"); }
       void notes1() { omrFileTest("notes1"); }
+      void match();
       };
 
 //---------------------------------------------------------
@@ -61,6 +67,67 @@ void TestNotes::omrFileTest(QString file)
       QVERIFY(saveCompareScore(score1, file + ".mscx", DIR + file + "-ref.mscx"));
       }
 
+//---------------------------------------------------------
+//   byteMatch
+//    score of the former byte wise Pattern::match()
+//---------------------------------------------------------
+
+static double byteMatch(const Pattern* a, const Pattern* b)
+      {
+      int n = a->image()->byteCount();
+      int k = 0;
+      const uchar* p1 = a->image()->bits();
+      const uchar* p2 = b->image()->bits();
+      for (int i = 0; i < n; ++i)
+            k += Omr::bitsSetTable[p1[i] ^ p2[i]];
+      k -= (a->image()->bytesPerLine() * 8 - a->w()) * a->h();
+      return 1.0 - (double(k) / (a->h() * a->w()));
+      }
+
+//---------------------------------------------------------
+//   match
+//    match a note head all over a sample page; the bit
+//    packed scores, from a pattern and from a window of
+//    the page, have to be the ones of the byte wise
+//    matcher the note thresholds were tuned to
+//---------------------------------------------------------
+
+void TestNotes::match()
+      {
+      Score* score = readScore(DIR + "notes1.mscx");
+      QVERIFY(score);
+      score->doLayout();
+      QVERIFY(savePdf(score, "match.pdf"));
+      Pdf pdf;
+      QVERIFY(pdf.open("match.pdf"));
+      QImage image = pdf.page(0);
+      QVERIFY(!image.isNull());
+
+      Pattern head(&symbols[0][quartheadSym], score->spatium() * 300.0 / MScore::DPI);
+      int hw  = head.w();
+      int hh  = head.h();
+      int nw  = head.words();
+      int wpl = image.bytesPerLine() / 4;
+      QVector<quint64> win(hh * nw);
+
+      for (int y = 0; y < image.height() - hh; y += 13) {
+            for (int x = 0; x < image.width() - hw; x += 7) {
+                  Pattern p(&image, x, y, hw, hh);
+                  double val = head.match(&p);
+                  QCOMPARE(val, byteMatch(&head, &p));
+
+                  quint64* d = win.data();
+                  for (int row = y; row < y + hh; ++row) {
+                        const uint* line = (const uint*)image.constScanLine(row);
+                        for (int i = 0; i < nw; ++i)
+                              *d++ = Pattern::extract(line, wpl, x + i * 64) & head.mask(i);
+                        }
+                  QCOMPARE(head.match(win.constData()), val);
+                  }
+            }
+      delete score;
+      }
+
 QTEST_MAIN(TestNotes)
 #include "tst_notes.moc"
 
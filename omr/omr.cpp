@@ -21,6 +21,7 @@
 #include "omr.h"
 #include "omrview.h"
 #include "libmscore/xml.h"
+#include "libmscore/mscore.h"
 #include "omrpage.h"
 #include "pdf.h"
 #ifdef OCR
@@ -153,32 +154,64 @@ bool Omr::readPdf()
       return true;
       }
 
+//---------------------------------------------------------
+//   readPage
+//---------------------------------------------------------
+
+static void readPage(OmrPage* page)
+      {
+      page->read(0);
+      }
+
 //---------------------------------------------------------
 //   process
+//    pages are independent and read concurrently; the
+//    results are merged in page order afterwards
 //---------------------------------------------------------
 
 void Omr::process()
       {
+      QtConcurrent::blockingMap(_pages, readPage);
+
       double sp = 0;
       double w  = 0;
 
       int pages = 0;
       int n = _pages.size();
       for (int i = 0; i < n; ++i) {
-            _pages[i]->read(i);
             if (_pages[i]->systems().size() > 0) {
                   sp += _pages[i]->spatium();
                   ++pages;
                   }
             w  += _pages[i]->width();
             }
-      _spatium = sp / pages;
-      w       /= n;
-      _dpmm    = w / 210.0;            // PaperSize A4
+      if (pages)
+            _spatium = sp / pages;
+      if (n)
+            _dpmm = (w / n) / 210.0;     // PaperSize A4
+
+      if (MScore::debugMode) {
+            OmrTimes t = times();
+            qDebug("Omr: %d pages, crop %.1f deskew %.1f staff lines %.1f systems %.1f (ms, summed over pages)",
+               n, t.crop, t.deSkew, t.staffLines, t.systems);
+            }
 
 // printf("*** spatium: %f mm  dpmm: %f\n", spatiumMM(), _dpmm);
       }
 
+//---------------------------------------------------------
+//   times
+//    stage timings summed over all pages
+//---------------------------------------------------------
+
+OmrTimes Omr::times() const
+      {
+      OmrTimes t;
+      foreach(const OmrPage* page, _pages)
+            t += page->times();
+      return t;
+      }
+
 //---------------------------------------------------------
 //   spatiumMM
 //---------------------------------------------------------
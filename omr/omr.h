@@ -30,6 +30,7 @@ class OmrPage;
 class Ocr;
 class Score;
 class ScoreView;
+struct OmrTimes;
 
 #ifdef OMR
 
@@ -78,6 +79,7 @@ class Omr {
       Score* score() const                 { return _score;     }
       const QString& path() const          { return _path;      }
       void process();
+      OmrTimes times() const;
       };
 
 #else
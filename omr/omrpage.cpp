@@ -48,6 +48,19 @@ struct Lv {
             }
       };
 
+//---------------------------------------------------------
+//   OmrTimes
+//---------------------------------------------------------
+
+OmrTimes& OmrTimes::operator+=(const OmrTimes& t)
+      {
+      crop       += t.crop;
+      deSkew     += t.deSkew;
+      staffLines += t.staffLines;
+      systems    += t.systems;
+      return *this;
+      }
+
 //---------------------------------------------------------
 //   OmrPage
 //---------------------------------------------------------
@@ -74,12 +87,24 @@ bool OmrPage::dot(int x, int y) const
 
 void OmrPage::read(int /*pageNo*/)
       {
+      QElapsedTimer t;
+      t.start();
       crop();
       slice();
+      _times.crop += t.nsecsElapsed() / 1000000.0;
+
+      t.restart();
       deSkew();
+      _times.deSkew += t.nsecsElapsed() / 1000000.0;
+
+      t.restart();
       crop();
       slice();
+      _times.crop += t.nsecsElapsed() / 1000000.0;
+
+      t.restart();
       getStaffLines();
+      _times.staffLines += t.nsecsElapsed() / 1000000.0;
 
       //--------------------------------------------------
       //    create systems
@@ -100,8 +125,9 @@ void OmrPage::read(int /*pageNo*/)
       //    search bar lines
       //--------------------------------------------------
 
-      QFuture<void> bl = QtConcurrent::map(_systems, &OmrSystem::searchBarLines);
-      bl.waitForFinished();
+      t.restart();
+      QtConcurrent::blockingMap(_systems, &OmrSystem::searchBarLines);
+      _times.systems += t.nsecsElapsed() / 1000000.0;
       }
 
 //---------------------------------------------------------
@@ -225,8 +251,6 @@ void OmrSystem::searchNotes(int sym)
       {
       Pattern pattern(&symbols[0][sym], _page->spatium());
 
-      QList<OmrNote*> nl1;
-      QList<OmrNote*> nl2;
       for (int i = 0; i < _staves.size(); ++i) {
             OmrStaff* r = &_staves[i];
             int x1 = r->x();
@@ -235,20 +259,24 @@ void OmrSystem::searchNotes(int sym)
             //
             // search notes on a range of vertical line position
             //
-            for (int line = -5; line < 14; ++line) {
-                  searchNotes(&nl2, &pattern, x1, x2, r->y(), line, sym);
+            QList<OmrNote*> nl[NOTE_LINES];
+            searchNotes(nl, &pattern, x1, x2, r->y(), sym);
+
+            QList<OmrNote*> nl1;
+            for (int line = 0; line < NOTE_LINES; ++line) {
+                  QList<OmrNote*>& nl2 = nl[line];
                   foreach(OmrNote* n, nl1) {
                         foreach(OmrNote* m, nl2) {
                               if (m->r.intersects(n->r)) {
                                     nl2.removeOne(m);
+                                    delete m;
                                     }
                               }
                         }
                   r->notes().append(nl1);
                   nl1 = nl2;
-                  nl2.clear();      // TODO: optimize
                   }
-            r->notes().append(nl2);
+            r->notes().append(nl1);
             }
       }
 
@@ -764,50 +792,86 @@ struct Peak {
 //   searchNotes
 //---------------------------------------------------------
 
-void OmrSystem::searchNotes(QList<OmrNote*>* noteList, Pattern* pattern,
-   int x1, int x2, int y, int line, int sym)
+void OmrSystem::searchNotes(QList<OmrNote*>* noteLists, const Pattern* pattern,
+   int x1, int x2, int y, int sym)
       {
       double _spatium = _page->spatium();
-      y += line * _spatium * .5;
 
       // look for note heads
       int hh = pattern->h();
       int hw = pattern->w();
+      int nw = pattern->words();
       x2 -= hw;
 
-      QList<Peak> notePeaks;
-      int xx1    = -1000;
-      double val = 0.0;
+      //
+      // all line positions are matched in one sweep over x;
+      // the image rows they cover are extracted once per x
+      // into win as 64 bit words aligned to the pattern
+      //
+      int top[NOTE_LINES];
+      for (int line = 0; line < NOTE_LINES; ++line)
+            top[line] = int(y + (FIRST_NOTE_LINE + line) * _spatium * .5) - hh/2;
+      int y1   = top[0];
+      int rows = top[NOTE_LINES-1] + hh - y1;
+
+      const uint* bits = _page->bits();
+      int wpl          = _page->wordsPerLine();
+      int ih           = _page->image().height();
+      QVector<quint64> win(rows * nw);
+
+      QList<Peak> notePeaks[NOTE_LINES];
+      int xx1[NOTE_LINES];
+      double val[NOTE_LINES];
+      for (int line = 0; line < NOTE_LINES; ++line) {
+            xx1[line] = -1000;
+            val[line] = 0.0;
+            }
 
       for (int x = x1; x < x2; ++x) {
-            Pattern p(&_page->image(), x, y - hh/2, hw, hh);
-            double val1 = p.match(pattern);
-            if (x > (xx1 + hw)) {
-                  if (xx1 >= 0)
-                        notePeaks.append(Peak(xx1, val));
-                  xx1 = x;
-                  val = val1;
+            quint64* d = win.data();
+            for (int row = y1; row < y1 + rows; ++row) {
+                  if (row < 0 || row >= ih) {
+                        for (int i = 0; i < nw; ++i)
+                              *d++ = 0;
+                        continue;
+                        }
+                  const uint* line = bits + row * wpl;
+                  for (int i = 0; i < nw; ++i)
+                        *d++ = Pattern::extract(line, wpl, x + i * 64) & pattern->mask(i);
                   }
-            else {
-                  if (val1 > val) {
-                        val = val1;
-                        xx1 = x;
+            for (int line = 0; line < NOTE_LINES; ++line) {
+                  double val1 = pattern->match(win.constData() + (top[line] - y1) * nw);
+
+                  if (x > (xx1[line] + hw)) {
+                        if (xx1[line] >= 0)
+                              notePeaks[line].append(Peak(xx1[line], val[line]));
+                        xx1[line] = x;
+                        val[line] = val1;
+                        }
+                  else {
+                        if (val1 > val[line]) {
+                              val[line] = val1;
+                              xx1[line] = x;
+                              }
                         }
                   }
             }
 
       double th = 0.9; // 0.7;
-      qSort(notePeaks);
-      int n = notePeaks.size();
-      for (int i = 0; i < n; ++i) {
-            if (notePeaks[i].val < th)
-                  break;
-            OmrNote* note = new OmrNote;
-            note->r.setRect(notePeaks[i].x, y - hh/2, hw, hh);
-            note->line    = line;
-            note->sym     = sym;
-            note->prob    = notePeaks[i].val;
-            noteList->append(note);
+      for (int line = 0; line < NOTE_LINES; ++line) {
+            QList<Peak>& peaks = notePeaks[line];
+            qSort(peaks);
+            int n = peaks.size();
+            for (int i = 0; i < n; ++i) {
+                  if (peaks[i].val < th)
+                        break;
+                  OmrNote* note = new OmrNote;
+                  note->r.setRect(peaks[i].x, top[line], hw, hh);
+                  note->line    = FIRST_NOTE_LINE + line;
+                  note->sym     = sym;
+                  note->prob    = peaks[i].val;
+                  noteLists[line].append(note);
+                  }
             }
       }
 
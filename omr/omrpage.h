@@ -52,6 +52,21 @@ class OmrNote {
 
 class OmrPage;
 
+//---------------------------------------------------------
+//   OmrTimes
+//    milliseconds spent in the stages of OmrPage::read()
+//---------------------------------------------------------
+
+struct OmrTimes {
+      double crop;            // crop() and slice()
+      double deSkew;
+      double staffLines;
+      double systems;         // bar line and note search
+
+      OmrTimes() : crop(0.0), deSkew(0.0), staffLines(0.0), systems(0.0) {}
+      OmrTimes& operator+=(const OmrTimes&);
+      };
+
 //---------------------------------------------------------
 //   OmrStaff
 //---------------------------------------------------------
@@ -76,7 +91,11 @@ class OmrSystem {
       OmrPage* _page;
       QList<OmrStaff> _staves;
 
-      void searchNotes(QList<OmrNote*>*, Pattern*, int x1, int x2, int y, int line, int sym);
+      // note heads are searched on line positions -5 .. 13
+      static const int FIRST_NOTE_LINE = -5;
+      static const int NOTE_LINES      = 19;
+
+      void searchNotes(QList<OmrNote*>* noteLists, const Pattern*, int x1, int x2, int y, int sym);
 
    public:
       OmrSystem(OmrPage* p) { _page = p;  }
@@ -109,6 +128,7 @@ class OmrPage {
 
       QList<QLine>  lines;
       QList<OmrSystem> _systems;
+      OmrTimes _times;
 
       void crop();
       void slice();
@@ -117,7 +137,8 @@ class OmrPage {
       void getStaffLines();
       double xproject2(int y);
       int xproject(const uint* p, int wl);
-      void radonTransform(ulong* projection, int w, int n, const QRect&);
+      void radonTransform(ulong* projection, int w, const QRect&);
+      quint64 shearProjection(int skew, int w, const QRect&);
 
    public:
       OmrPage(Omr* _parent);
@@ -141,6 +162,7 @@ class OmrPage {
       void readHeader(Score* score);
 
       const QList<OmrSystem>& systems() const { return _systems; }
+      const OmrTimes& times() const      { return _times;   }
 
 
       void write(Xml&) const;
@@ -29,6 +29,7 @@
 
 Pattern::Pattern()
       {
+      _words = 0;
       }
 
 Pattern::~Pattern()
@@ -46,21 +47,82 @@ Pattern::~Pattern()
 
 double Pattern::match(const Pattern* a) const
       {
-      int n = image()->byteCount();
-      if (n != a->image()->byteCount())
+      if (w() != a->w() || h() != a->h())
             return 0.0;
+      return match(a->_bits.constData());
+      }
+
+//---------------------------------------------------------
+//   match
+//    compare with h() rows of words() 64 bit words,
+//    for example a window of a page image.
+//    The score is the one of the former byte wise matcher,
+//    which subtracted the overscan of the 32 bit padded
+//    rows from the difference; this raises the score by
+//    overscan / w(). The note thresholds are tuned to it.
+//---------------------------------------------------------
+
+double Pattern::match(const quint64* rows) const
+      {
       int k = 0;
-      const uchar* p1 = image()->bits();
-      const uchar* p2 = a->image()->bits();
-      for (int i = 0; i < n; ++i) {
-            uchar v = (*(p1++)) ^ (*(p2++));
-            k += Omr::bitsSetTable[v];
-            }
-      // remove overscan
-      k -= (image()->bytesPerLine() * 8 - w()) * h();
+      int n = _bits.size();
+      const quint64* p = _bits.constData();
+      for (int i = 0; i < n; ++i)
+            k += popcount(p[i] ^ rows[i]);
+      k -= (((w() + 31) / 32) * 32 - w()) * h();
       return 1.0 - (double(k) / (h() * w()));
       }
 
+//---------------------------------------------------------
+//   pack
+//    build the 64 bit rows from _image
+//---------------------------------------------------------
+
+void Pattern::pack()
+      {
+      int wpl = _image.bytesPerLine() / 4;
+      _words  = (w() + 63) / 64;
+      _bits.resize(_words * h());
+      quint64* d = _bits.data();
+      for (int y = 0; y < h(); ++y) {
+            const uint* line = (const uint*)_image.constScanLine(y);
+            for (int i = 0; i < _words; ++i)
+                  *d++ = extract(line, wpl, i * 64) & mask(i);
+            }
+      }
+
+//---------------------------------------------------------
+//   mask
+//    valid pixels of 64 bit word of a row
+//---------------------------------------------------------
+
+quint64 Pattern::mask(int word) const
+      {
+      int n = w() - word * 64;
+      return n >= 64 ? ~quint64(0) : ((quint64(1) << n) - 1);
+      }
+
+//---------------------------------------------------------
+//   extract
+//    return the 64 pixels of a MonoLSB scan line starting
+//    at pixel x; pixels right of the line are zero
+//---------------------------------------------------------
+
+quint64 Pattern::extract(const uint* line, int wpl, int x)
+      {
+      int i     = x / 32;
+      int shift = x % 32;
+      quint64 v = 0;
+      if (i < wpl)
+            v = line[i];
+      if (i + 1 < wpl)
+            v |= quint64(line[i + 1]) << 32;
+      v >>= shift;
+      if (shift && i + 2 < wpl)
+            v |= quint64(line[i + 2]) << (64 - shift);
+      return v;
+      }
+
 //---------------------------------------------------------
 //   Pattern
 //    create a Pattern from symbol
@@ -91,14 +153,15 @@ Pattern::Pattern(Sym* symbol, double spatium)
       painter.end();
 
       int ww = _w % 32;
-      if (ww == 0)
-            return;
-      uint mask = 0xffffffff << ww;
-      int n = ((_w + 31) / 32) - 1;
-      for (int i = 0; i < _h; ++i) {
-            uint* p = ((uint*)_image.scanLine(i)) + n;
-            *p = ((*p) & ~mask);
+      if (ww) {
+            uint mask = 0xffffffff << ww;
+            int n = ((_w + 31) / 32) - 1;
+            for (int i = 0; i < _h; ++i) {
+                  uint* p = ((uint*)_image.scanLine(i)) + n;
+                  *p = ((*p) & ~mask);
+                  }
             }
+      pack();
       }
 
 //---------------------------------------------------------
@@ -110,14 +173,15 @@ Pattern::Pattern(QImage* img, int x, int y, int w, int h)
       {
       _image = img->copy(x, y, w, h);
       int ww = w % 32;
-      if (ww == 0)
-            return;
-      uint mask = 0xffffffff << ww;
-      int n = ((w + 31) / 32) - 1;
-      for (int i = 0; i < h; ++i) {
-            uint* p = ((uint*)_image.scanLine(i)) + n;
-            *p     &= ~mask;
+      if (ww) {
+            uint mask = 0xffffffff << ww;
+            int n = ((w + 31) / 32) - 1;
+            for (int i = 0; i < h; ++i) {
+                  uint* p = ((uint*)_image.scanLine(i)) + n;
+                  *p     &= ~mask;
+                  }
             }
+      pack();
       }
 
 //---------------------------------------------------------
@@ -26,11 +26,17 @@ class Sym;
 //---------------------------------------------------------
 //   Pattern
 //    _n % sizeof(int)  is zero, patterns are 32bit padded
+//    the pixels are also kept as rows of 64 bit words
+//    for matching against a sliding image window
 //---------------------------------------------------------
 
 class Pattern {
    protected:
       QImage _image;
+      QVector<quint64> _bits;       // _words per row, overscan cleared
+      int _words;
+
+      void pack();
 
    public:
       Pattern();
@@ -39,11 +45,19 @@ class Pattern {
       Pattern(QImage*, int, int, int, int);
 
       double match(const Pattern*) const;
+      double match(const quint64* rows) const;
       void dump() const;
       const QImage* image() const { return &_image; }
       int w() const { return _image.width(); }
       int h() const { return _image.height(); }
       bool dot(int x, int y) const;
+
+      int words() const                   { return _words; }
+      const quint64* row(int y) const     { return _bits.constData() + y * _words; }
+      quint64 mask(int word) const;
+
+      static quint64 extract(const uint* line, int wpl, int x);
+      static int popcount(quint64 v)      { return __builtin_popcountll(v); }
       };
 
 #endif
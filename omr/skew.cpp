@@ -22,6 +22,7 @@
 #include "utils.h"
 #include "omr.h"
 #include "omrpage.h"
+#include "pattern.h"
 
 //=============================================================================
 //  inspired by ImageMagick (http://www.imagemagick.org)
@@ -60,24 +61,48 @@ static inline double RadiansToDegrees(double r) {
 //---------------------------------------------------------
 
 class RadonInfo {
-      int size;
+      QVector<ushort> buffer;
 
    public:
       ushort* cells;
       int width, height;
 
-      RadonInfo(ulong w, ulong h) {
+      RadonInfo() { cells = 0; width = height = 0; }
+      void resize(int w, int h) {
             width  = w;
             height = h;
-            size   = w * h;
-            cells  = new ushort[size];
+            if (buffer.size() < w * h)
+                  buffer.resize(w * h);
+            cells = buffer.data();
             }
-      ~RadonInfo() { delete[] cells; }
-      void reset() { memset(cells, 0, size * sizeof(*cells)); }
+      void reset() { memset(cells, 0, width * height * sizeof(*cells)); }
       ushort getCell(int x, int y) const         { return cells[height * x + y];  }
       void   setCell(int x, int y, ushort value) { cells[height * x + y] = value; }
       };
 
+//---------------------------------------------------------
+//   SkewBuffers
+//    scratch space of skew(); kept per thread and reused
+//    for all slices and pages
+//---------------------------------------------------------
+
+struct SkewBuffers {
+      RadonInfo src;
+      RadonInfo dst;
+      QVector<ulong> projection;
+      QVector<int> offsets;
+      QVector<uint> rows;
+      };
+
+static QThreadStorage<SkewBuffers*> skewBuffers;
+
+static SkewBuffers* buffers()
+      {
+      if (!skewBuffers.hasLocalData())
+            skewBuffers.setLocalData(new SkewBuffers);
+      return skewBuffers.localData();
+      }
+
 //---------------------------------------------------------
 //   radonProjection
 //---------------------------------------------------------
@@ -123,38 +148,87 @@ static void radonProjection(RadonInfo* src, RadonInfo* dst, int sign, ulong* pro
 
 //---------------------------------------------------------
 //   radonTransform
+//    coarse transform: a cell is a 32 pixel word of two
+//    scan lines, w is the number of cells rounded up to a
+//    power of two
 //---------------------------------------------------------
 
-void OmrPage::radonTransform(ulong* projection, int w, int n, const QRect& r)
+void OmrPage::radonTransform(ulong* projection, int w, const QRect& r)
       {
-      int h = r.height();
-      RadonInfo* src = new RadonInfo(w, h);
-      RadonInfo* dst = new RadonInfo(w, h);
+      SkewBuffers* b = buffers();
+      int wl = wordsPerLine();
+      int h  = (r.height() + 1) / 2;
+      RadonInfo* src = &b->src;
+      RadonInfo* dst = &b->dst;
+      src->resize(w, h);
+      dst->resize(w, h);
 
       src->reset();
       for (int y = 0; y < h; y++) {
-            int i = n;
-            const uchar* p = (const uchar*)scanLine(r.y() + y);
-            for (int x = 0; x < n; ++x)
-                  src->setCell(--i, y, Omr::bitsSetTable[*p++]);
+            int y1 = r.y() + 2 * y;
+            const uint* p1 = scanLine(y1);
+            const uint* p2 = (2 * y + 1 < r.height()) ? scanLine(y1 + 1) : 0;
+            int i = wl;
+            for (int x = 0; x < wl; ++x)
+                  src->setCell(--i, y, Pattern::popcount(p1[x]) + (p2 ? Pattern::popcount(p2[x]) : 0));
             }
       radonProjection(src, dst, -1, projection);
 
       src->reset();
       for (int y = 0; y < h; y++) {
-            const uchar* p = (const uchar*)scanLine(r.y() + y);
-            for (int x = 0; x < n; ++x)
-                  src->setCell(x, y, Omr::bitsSetTable[*p++]);
+            int y1 = r.y() + 2 * y;
+            const uint* p1 = scanLine(y1);
+            const uint* p2 = (2 * y + 1 < r.height()) ? scanLine(y1 + 1) : 0;
+            for (int x = 0; x < wl; ++x)
+                  src->setCell(x, y, Pattern::popcount(p1[x]) + (p2 ? Pattern::popcount(p2[x]) : 0));
             }
       radonProjection(src, dst, 1, projection);
+      }
+
+//---------------------------------------------------------
+//   shearProjection
+//    full resolution projection of r for a single slope:
+//    lines drop skew scan lines over w bytes; returns the
+//    same measure as radonProjection()
+//---------------------------------------------------------
+
+quint64 OmrPage::shearProjection(int skew, int w, const QRect& r)
+      {
+      SkewBuffers* b = buffers();
+      int n = wordsPerLine() * 4;
+      int h = r.height();
+      b->offsets.resize(n);
+      b->rows.resize(h);
+      int* offsets = b->offsets.data();
+      uint* rows   = b->rows.data();
+      const uchar* db = (const uchar*)scanLine(r.y());
 
-      delete dst;
-      delete src;
+      for (int x = 0; x < n; ++x)
+            offsets[x] = int(floor(double(skew) * x / w + .5));
+      for (int y = 0; y < h; ++y) {
+            uint sum = 0;
+            for (int x = 0; x < n; ++x) {
+                  int yy = y + offsets[x];
+                  if (yy >= 0 && yy < h)
+                        sum += Omr::bitsSetTable[db[yy * n + x]];
+                  }
+            rows[y] = sum;
+            }
+      quint64 sum = 0;
+      for (int y = 0; y < h - 1; ++y) {
+            qint64 delta = qint64(rows[y]) - qint64(rows[y + 1]);
+            sum += delta * delta;
+            }
+      return sum;
       }
 
 //---------------------------------------------------------
 //   skew
 //    compute image skew angle
+//    The angle is estimated with a radon transform on a
+//    downsampled image (32 x 2 pixel cells) and refined
+//    by projecting the full resolution image along the
+//    slopes next to the estimate.
 //---------------------------------------------------------
 
 double OmrPage::skew(const QRect& r)
@@ -165,19 +239,36 @@ double OmrPage::skew(const QRect& r)
       int width = 1;
       for (; width < nn; width <<= 1)
             ;
-      int n = 2 * width - 1;
 
-      ulong* projection = new ulong[n];
-      radonTransform(projection, width, nn, r);
-      uint max_projection = 0;
-      int skew            = 0;
+      // coarse: cells are 4 bytes wide and 2 lines high, so a
+      // coarse slope of one line is two lines at full resolution
+      int cw = width / 4;
+      int n  = 2 * cw - 1;
+      SkewBuffers* b = buffers();
+      b->projection.resize(n);
+      ulong* projection = b->projection.data();
+      radonTransform(projection, cw, r);
+      ulong max_projection = 0;
+      int coarse           = 0;
       for (int i = 0; i < n; i++) {
             if (projection[i] > max_projection) {
-                  skew = i - width + 1;
+                  coarse = i - cw + 1;
                   max_projection = projection[i];
                   }
             }
-      delete[] projection;
+
+      // fine
+      quint64 max = 0;
+      int skew    = 0;
+      int s1      = qMax(2 * coarse - 2, -(width - 1));
+      int s2      = qMin(2 * coarse + 2, width - 1);
+      for (int s = s1; s <= s2; ++s) {
+            quint64 val = shearProjection(s, width, r);
+            if (val > max) {
+                  skew = s;
+                  max  = val;
+                  }
+            }
       return RadiansToDegrees(-atan((double) skew/width/8));
       }
 